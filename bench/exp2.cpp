@@ -0,0 +1,77 @@
+// Compares fastExp2 against std::pow(2, x) over the pitch range the
+// oscillators see, reporting the worst case error in cents and the cost per
+// value.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "approx.hpp"
+
+using rack::simd::float_4;
+
+namespace {
+
+constexpr int VALUES = 1 << 12;
+constexpr int ROUNDS = 2000;
+
+// Keeps the optimiser from discarding the results.
+volatile float sink;
+
+template <typename F>
+double nanosecondsPerValue(F f) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < ROUNDS; round++) {
+    sink = f();
+  }
+  const std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (static_cast<double>(ROUNDS) * VALUES);
+}
+
+}  // namespace
+
+int main() {
+  // Pitches in volts (octaves) spanning the full CV plus knob range.
+  std::vector<float> pitches(VALUES);
+  for (int i = 0; i < VALUES; i++) {
+    pitches[i] = -10.f + 20.f * i / VALUES;
+  }
+
+  double maxCents = 0.0;
+  for (float pitch = -10.f; pitch <= 10.f; pitch += 1e-4f) {
+    const double exact = std::exp2(static_cast<double>(pitch));
+    const double cents = 1200.0 * std::log2(fastExp2(pitch) / exact);
+    maxCents = std::fmax(maxCents, std::fabs(cents));
+  }
+
+  const double powNs = nanosecondsPerValue([&] {
+    float sum = 0.f;
+    for (float pitch : pitches) {
+      sum += std::pow(2.f, pitch);
+    }
+    return sum;
+  });
+  const double fastNs = nanosecondsPerValue([&] {
+    float sum = 0.f;
+    for (float pitch : pitches) {
+      sum += fastExp2(pitch);
+    }
+    return sum;
+  });
+  const double fast4Ns = nanosecondsPerValue([&] {
+    float_4 sum = 0.f;
+    for (int i = 0; i < VALUES; i += 4) {
+      sum += fastExp2(float_4::load(&pitches[i]));
+    }
+    return sum[0] + sum[1] + sum[2] + sum[3];
+  });
+
+  std::printf("max error         %.5f cents\n", maxCents);
+  std::printf("std::pow          %.3f ns/value\n", powNs);
+  std::printf("fastExp2<float>   %.3f ns/value (%.1fx)\n", fastNs,
+              powNs / fastNs);
+  std::printf("fastExp2<float_4> %.3f ns/value (%.1fx)\n", fast4Ns,
+              powNs / fast4Ns);
+  return 0;
+}
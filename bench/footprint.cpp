@@ -0,0 +1,216 @@
+// Reports what a Gemini instance costs in memory: its size, where its audio
+// state sits, and how many cache lines rendering a block walks through. Then
+// times many instances processed in turn, as Rack's engine does, against a
+// single one, which is where that footprint shows up as cache misses.
+//
+// usage: footprint [-n instances] [-f frames] [-o oversampling]
+//   -n  instances in the larger run
+//   -f  frames processed per configuration, shared out between instances
+//   -o  oversampling factor (1, 2, 4 or 8)
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "patch.hpp"
+
+namespace {
+
+constexpr int CACHE_LINE = 64;
+
+struct Options {
+  int instances = 256;
+  int frames = 1 << 16;
+  int oversampling = 1;
+};
+
+// Cache lines spanned by `bytes` at `start`.
+int lines(const void* start, std::size_t bytes) {
+  const auto first = reinterpret_cast<std::uintptr_t>(start) / CACHE_LINE;
+  const auto last =
+      (reinterpret_cast<std::uintptr_t>(start) + bytes - 1) / CACHE_LINE;
+  return static_cast<int>(last - first + 1);
+}
+
+std::ptrdiff_t offset(const Gemini& gemini, const void* member) {
+  return static_cast<const char*>(member) -
+         reinterpret_cast<const char*>(&gemini);
+}
+
+void printRow(const char* name, std::size_t bytes, int lines) {
+  std::printf("  %-30s %8zu %8d\n", name, bytes, lines);
+}
+
+// Cache lines of `bytes` starting on a line, as a kernel's stack frame is
+// laid out.
+int alignedLines(std::size_t bytes) {
+  return static_cast<int>((bytes + CACHE_LINE - 1) / CACHE_LINE);
+}
+
+void reportLayout(const Gemini& gemini) {
+  const char* audioStart = reinterpret_cast<const char*>(&gemini.paramBank);
+  const char* audioEnd = reinterpret_cast<const char*>(&gemini.pair + 1);
+  std::printf("%-32s %8s %8s\n", "", "bytes", "lines");
+  printRow("instance", sizeof(Gemini), lines(&gemini, sizeof(Gemini)));
+  printRow("audio state", audioEnd - audioStart,
+           lines(audioStart, audioEnd - audioStart));
+  printRow("  param bank", sizeof(gemini.paramBank),
+           lines(&gemini.paramBank, sizeof(gemini.paramBank)));
+  printRow("  oscillators, per group", 2 * sizeof(gemini.castor[0]),
+           lines(&gemini.castor[0], sizeof(gemini.castor[0])) +
+               lines(&gemini.pollux[0], sizeof(gemini.pollux[0])));
+  printRow("  decimators, per group", 2 * sizeof(gemini.castorDecimator[0]),
+           lines(&gemini.castorDecimator[0],
+                 sizeof(gemini.castorDecimator[0])) +
+               lines(&gemini.polluxDecimator[0],
+                     sizeof(gemini.polluxDecimator[0])));
+  printRow("  lfo", sizeof(gemini.lfo),
+           lines(&gemini.lfo, sizeof(gemini.lfo)));
+  printRow("  block", sizeof(gemini.block),
+           lines(&gemini.block, sizeof(gemini.block)));
+  printRow("  block, per group", sizeof(Gemini::GroupBlock),
+           lines(&gemini.groupBlocks[0], sizeof(Gemini::GroupBlock)));
+  printRow("  pair", sizeof(gemini.pair),
+           lines(&gemini.pair, sizeof(gemini.pair)));
+#ifdef GEMINI_WIDE_KERNELS
+  // The wide kernels gather the voices they render into their own state.
+  printRow("gathered, 8 lane kernels", sizeof(gemini.voices8),
+           lines(&gemini.voices8, sizeof(gemini.voices8)));
+  printRow("gathered, 16 lane kernels", sizeof(gemini.voices16),
+           lines(&gemini.voices16, sizeof(gemini.voices16)));
+#endif
+  // The kernels' working space is on the stack, and so is shared by every
+  // instance on the thread.
+  printRow("stack, per kernel",
+           2 * sizeof(OscillatorBlock<simd::float_4>),
+           2 * alignedLines(sizeof(OscillatorBlock<simd::float_4>)));
+  printRow("  with 8 lane kernels",
+           2 * sizeof(OscillatorBlock<wide::float_8>),
+           2 * alignedLines(sizeof(OscillatorBlock<wide::float_8>)));
+  printRow("  with 16 lane kernels",
+           2 * sizeof(OscillatorBlock<wide::float_16>),
+           2 * alignedLines(sizeof(OscillatorBlock<wide::float_16>)));
+  std::printf("\naudio state starts %td bytes in, %s\n",
+              offset(gemini, audioStart),
+              offset(gemini, audioStart) % CACHE_LINE == 0
+                  ? "on a cache line"
+                  : "mid cache line");
+}
+
+// The cache lines a block of `groups` groups of voices reads or writes,
+// counted from the layout of gemini.
+int linesPerBlock(Gemini& gemini, int groups) {
+  const Gemini::Block& block = gemini.block;
+  const std::size_t frameBytes = BLOCK_SIZE * sizeof(simd::float_4);
+  int total = lines(&gemini.paramBank, sizeof(gemini.paramBank)) +
+              lines(&gemini.lfo, sizeof(gemini.lfo));
+  for (int g = 0; g < groups; g++) {
+    total += lines(&gemini.castor[g], sizeof(gemini.castor[g])) +
+             lines(&gemini.pollux[g], sizeof(gemini.pollux[g])) +
+             lines(&gemini.castorDecimator[g],
+                   sizeof(gemini.castorDecimator[g])) +
+             lines(&gemini.polluxDecimator[g],
+                   sizeof(gemini.polluxDecimator[g]));
+    // Only connected inputs are captured.
+    const Gemini::GroupBlock& groupBlock = gemini.groupBlocks[g];
+    for (int i = 0; i < Gemini::INPUTS_LEN; i++) {
+      if (gemini.inputs[i].isConnected()) {
+        total += lines(groupBlock.cv[i], frameBytes);
+      }
+    }
+    for (int o = 0; o < Gemini::OUTPUTS_LEN; o++) {
+      total += lines(groupBlock.out[o], frameBytes);
+    }
+  }
+  total += lines(block.connected, sizeof(block.connected)) +
+           lines(block.channels, sizeof(block.channels)) +
+           lines(block.lfo, sizeof(block.lfo)) +
+           lines(block.outChannels, sizeof(block.outChannels));
+  // The stack's OscillatorBlocks are reused by every group and slice,
+  // whatever the oversampling.
+  total += 2 * alignedLines(sizeof(OscillatorBlock<simd::float_4>));
+  return total;
+}
+
+void reportLinesTouched(Gemini& gemini) {
+  std::printf("\n%-8s %12s %14s\n", "voices", "lines/block",
+              "lines/process");
+  for (int groups : {1, Gemini::MAX_GROUPS}) {
+    const int perBlock = linesPerBlock(gemini, groups);
+    std::printf("%-8s %12d %14.1f\n", groups == 1 ? "1-4" : "13-16",
+                perBlock, static_cast<double>(perBlock) / BLOCK_SIZE);
+  }
+}
+
+// Nanoseconds per instance per frame, for `count` instances each processing
+// a frame in turn.
+double timeInstances(int count, const Options& options) {
+  std::vector<std::unique_ptr<Gemini>> instances;
+  Module::ProcessArgs args = {SAMPLE_RATE, 1.f / SAMPLE_RATE, 0};
+  for (int i = 0; i < count; i++) {
+    instances.push_back(std::make_unique<Gemini>());
+    Module::ProcessArgs setUpArgs = args;
+    setUpPatch(*instances.back(), setUpArgs, Gemini::CHORUS, false, true,
+               false, options.oversampling);
+  }
+  const int frames = std::max(options.frames / count, 4 * BLOCK_SIZE);
+  const auto start = std::chrono::steady_clock::now();
+  for (int frame = 0; frame < frames; frame++) {
+    for (auto& gemini : instances) {
+      gemini->process(args);
+    }
+    args.frame++;
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() * 1e9 / frames / count;
+}
+
+bool parseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+      options->instances = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "-f") && i + 1 < argc) {
+      options->frames = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "-o") && i + 1 < argc) {
+      options->oversampling = std::atoi(argv[++i]);
+    } else {
+      return false;
+    }
+  }
+  const int oversampling = options->oversampling;
+  return options->instances > 0 && options->frames > 0 && oversampling > 0 &&
+         oversampling <= Gemini::MAX_OVERSAMPLING &&
+         (oversampling & (oversampling - 1)) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, &options)) {
+    std::fprintf(stderr,
+                 "usage: %s [-n instances] [-f frames] [-o 1|2|4|8]\n",
+                 argv[0]);
+    return 1;
+  }
+  flushDenormals();
+
+  const auto gemini = std::make_unique<Gemini>();
+  reportLayout(*gemini);
+  reportLinesTouched(*gemini);
+
+  std::printf("\nchorus, filter on, mono, %dx oversampling\n",
+              options.oversampling);
+  std::printf("%-10s %18s\n", "instances", "ns/instance/frame");
+  // Warm up, then the single instance first so it isn't flattered by a
+  // cache the larger run has already filled.
+  timeInstances(1, options);
+  for (int count : {1, options.instances}) {
+    std::printf("%-10d %18.1f\n", count, timeInstances(count, options));
+  }
+  return 0;
+}
@@ -0,0 +1,370 @@
+// Runs Gemini headlessly and reports what a sample costs, for the oscillator
+// core on its own and for Gemini::process in every mode, alt mode, filter
+// setting and input configuration, then with only some outputs connected.
+// With -i, instead reports how many voices a core renders in real time with
+// the kernels for each instruction set the CPU supports, and with -p what
+// each pair of a Gemini Bank costs against a Gemini of its own, and with -u
+// what each unison copy costs against stacking Geminis.
+//
+// usage: gemini [-b] [-i] [-p] [-u] [-o oversampling] [-f frames]
+//   -b  band-limited waveforms
+//   -i  voices per core for each instruction set
+//   -p  cost per pair of Gemini Bank
+//   -u  cost per unison copy
+//   -o  oversampling factor (1, 2, 4 or 8)
+//   -f  frames rendered per configuration
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#include "patch.hpp"
+
+namespace {
+
+constexpr int WARMUP_FRAMES = 4096;
+
+// Slow pitch and duty movement for connected inputs, so that per-sample work
+// skipped for unchanged CV doesn't flatter the numbers.
+constexpr int MODULATION_LEN = 4096;
+float modulation[MODULATION_LEN];
+
+enum Inputs { UNCONNECTED, MONO, POLY, INPUTS_LEN };
+constexpr const char* INPUT_NAMES[INPUTS_LEN] = {"none", "mono", "poly16"};
+
+// The outputs connected, as a mask of 1 << Gemini::OutputId.
+constexpr int ALL_OUTPUTS = (1 << Gemini::OUTPUTS_LEN) - 1;
+constexpr int OUTPUT_SETS[] = {ALL_OUTPUTS, 1 << Gemini::CASTOR_MIX_OUTPUT,
+                               1 << Gemini::POLLUX_MIX_OUTPUT,
+                               1 << Gemini::MIX_OUTPUT, 0};
+constexpr const char* OUTPUT_SET_NAMES[] = {"all", "castor", "pollux", "mix",
+                                            "none"};
+
+constexpr const char* ISA_NAMES[] = {"sse4.2", "avx2", "avx-512"};
+
+struct Options {
+  bool bandLimited = false;
+  bool isas = false;
+  bool pairs = false;
+  bool unison = false;
+  int oversampling = 1;
+  int frames = 1 << 17;
+};
+
+// Keeps the optimiser from discarding the rendered output.
+volatile float sink;
+
+struct Result {
+  double nanosecondsPerSample;
+  double samplesPerSecond;
+};
+
+template <typename F>
+Result time(int frames, F renderFrame) {
+  for (int frame = 0; frame < WARMUP_FRAMES; frame++) {
+    renderFrame(frame);
+  }
+  const auto start = std::chrono::steady_clock::now();
+  for (int frame = 0; frame < frames; frame++) {
+    renderFrame(frame);
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return {elapsed.count() * 1e9 / frames, frames / elapsed.count()};
+}
+
+void printResult(const Result& result) {
+  std::printf("%10.1f %12.0f %9.1fx\n", result.nanosecondsPerSample,
+              result.samplesPerSecond, result.samplesPerSecond / SAMPLE_RATE);
+}
+
+template <bool FILTER, bool BAND_LIMITED>
+void benchmarkOscillator(const Options& options) {
+  OscillatorState<simd::float_4> oscillator;
+  oscillator.updateSampleRate(SAMPLE_RATE);
+  oscillator.enableFilter(FILTER);
+  const Signals<float> amplitude = {0.7f, 0.5f, 0.3f};
+  const simd::float_4 duty = 0.4f;
+
+  const Result result = time(options.frames, [&](int frame) {
+    const float cv = modulation[frame % MODULATION_LEN];
+    oscillator.updatePitch(simd::float_4(0.f, 0.25f, 0.5f, 0.75f) + cv);
+    oscillator.updatePhase();
+    sink = oscillator.template getOutput<FILTER>(
+        oscillator.template getSignals<FILTER, BAND_LIMITED>(duty, 0.f),
+        amplitude)[0];
+  });
+  std::printf("%-9s %-3s %-6s %-6s ", "osc x4", "-", FILTER ? "on" : "off",
+              "-");
+  printResult(result);
+}
+
+void connect(Input& input, int channels, float voltage, int frame) {
+  input.channels = channels;
+  for (int c = 0; c < channels; c++) {
+    input.voltages[c] =
+        voltage + 0.1f * c + modulation[(frame + 97 * c) % MODULATION_LEN];
+  }
+}
+
+Result benchmarkGemini(const Options& options, Gemini::Mode mode, bool alt,
+                       bool filter, Inputs inputs,
+                       int connectedOutputs = ALL_OUTPUTS,
+                       Gemini::Isa isa = Gemini::supportedIsa(),
+                       int unison = 1) {
+  Gemini gemini;
+  gemini.isa = isa;
+  gemini.unison = unison;
+  Module::ProcessArgs args = {SAMPLE_RATE, 1.f / SAMPLE_RATE, 0};
+  setUpPatch(gemini, args, mode, alt, filter, options.bandLimited,
+             options.oversampling);
+  for (int o = 0; o < Gemini::OUTPUTS_LEN; o++) {
+    gemini.outputs[o].channels = connectedOutputs >> o & 1;
+  }
+
+  const int channels =
+      inputs == POLY ? Gemini::MAX_CHANNELS : inputs == MONO ? 1 : 0;
+  const Result result = time(options.frames, [&](int frame) {
+    if (channels) {
+      connect(gemini.inputs[Gemini::CASTOR_PITCH_INPUT], channels, 0.5f,
+              frame);
+      connect(gemini.inputs[Gemini::POLLUX_PITCH_INPUT], channels, 0.2f,
+              frame);
+      connect(gemini.inputs[Gemini::CASTOR_DUTY_INPUT], channels, 0.f, frame);
+      connect(gemini.inputs[Gemini::POLLUX_DUTY_INPUT], channels, 0.f, frame);
+    }
+    gemini.process(args);
+    args.frame++;
+    sink = gemini.outputs[Gemini::MIX_OUTPUT].voltages[0];
+  });
+  return result;
+}
+
+// Voices rendered in real time by one core, from 16 voice polyphony, with each
+// instruction set's kernels.
+void benchmarkIsas(const Options& options) {
+  std::printf("%-8s %-9s %-6s %10s %12s\n", "isa", "mode", "filter",
+              "ns/sample", "voices/core");
+  const int supported = static_cast<int>(Gemini::supportedIsa());
+  for (int isa = 0; isa < static_cast<int>(std::size(ISA_NAMES)); isa++) {
+    if (isa > supported) {
+      std::printf("%-8s not supported by this CPU\n", ISA_NAMES[isa]);
+      continue;
+    }
+    for (int mode = 0; mode < Gemini::MODES_LEN; mode++) {
+      for (bool filter : {false, true}) {
+        const Result result = benchmarkGemini(
+            options, static_cast<Gemini::Mode>(mode), false, filter, POLY,
+            ALL_OUTPUTS, static_cast<Gemini::Isa>(isa));
+        std::printf("%-8s %-9s %-6s %10.1f %12.0f\n", ISA_NAMES[isa],
+                    MODE_NAMES[mode], filter ? "on" : "off",
+                    result.nanosecondsPerSample,
+                    Gemini::MAX_CHANNELS * result.samplesPerSecond /
+                        SAMPLE_RATE);
+      }
+    }
+  }
+}
+
+// Sets up each of the bank's pairs in mode, as setUpPatch() does a Gemini, with
+// the pitch knob a little higher for each.
+void setUpBank(GeminiBank& bank, Module::ProcessArgs& args, int pairs,
+               Gemini::Mode mode, bool filter, const Options& options) {
+  bank.bandLimited = options.bandLimited;
+  bank.oversampling = options.oversampling;
+  bank.pairs = pairs;
+  bank.onSampleRateChange({args.sampleRate, args.sampleTime});
+  for (Output& output : bank.outputs) {
+    output.channels = pairs;
+  }
+  auto finishBlock = [&] {
+    do {
+      bank.process(args);
+      args.frame++;
+    } while (args.frame % BLOCK_SIZE != 0);
+  };
+  // Picking a pair loads its knobs, and switching its mode loads that mode's,
+  // so each lands in a block of its own.
+  for (int pair = 0; pair < pairs; pair++) {
+    bank.params[GeminiBank::PAIR_PARAM].setValue(pair);
+    finishBlock();
+    bank.params[Gemini::BUTTON_PARAM].setValue(mode);
+    finishBlock();
+    bank.params[Gemini::CASTOR_PITCH_PARAM].setValue(0.1f + 0.05f * pair);
+    bank.params[Gemini::POLLUX_PITCH_PARAM].setValue(0.25f);
+    bank.params[Gemini::LFO_PARAM].setValue(0.5f);
+    bank.params[Gemini::CASTOR_DUTY_PARAM].setValue(0.3f);
+    bank.params[Gemini::POLLUX_DUTY_PARAM].setValue(0.6f);
+    bank.params[Gemini::CASTOR_RAMP_LEVEL_PARAM].setValue(0.7f);
+    bank.params[Gemini::CASTOR_PULSE_LEVEL_PARAM].setValue(0.5f);
+    bank.params[Gemini::CASTOR_SUB_LEVEL_PARAM].setValue(0.3f);
+    bank.params[Gemini::POLLUX_RAMP_LEVEL_PARAM].setValue(0.4f);
+    bank.params[Gemini::POLLUX_PULSE_LEVEL_PARAM].setValue(0.6f);
+    bank.params[Gemini::POLLUX_SUB_LEVEL_PARAM].setValue(0.2f);
+    finishBlock();
+  }
+  bank.params[Gemini::FILTER_ENABLE_BUTTON_PARAM].setValue(filter);
+  const int slewBlocks = static_cast<int>(
+      std::ceil(Gemini::SLEW_TIME * args.sampleRate / BLOCK_SIZE));
+  for (int frame = 0; frame < (1 + slewBlocks) * BLOCK_SIZE; frame++) {
+    bank.process(args);
+    args.frame++;
+  }
+}
+
+Result benchmarkBank(const Options& options, int pairs, Gemini::Mode mode,
+                     bool filter) {
+  GeminiBank bank;
+  Module::ProcessArgs args = {SAMPLE_RATE, 1.f / SAMPLE_RATE, 0};
+  setUpBank(bank, args, pairs, mode, filter, options);
+  return time(options.frames, [&](int frame) {
+    connect(bank.inputs[Gemini::CASTOR_PITCH_INPUT], pairs, 0.5f, frame);
+    connect(bank.inputs[Gemini::POLLUX_PITCH_INPUT], pairs, 0.2f, frame);
+    bank.process(args);
+    args.frame++;
+    sink = bank.outputs[Gemini::MIX_OUTPUT].voltages[0];
+  });
+}
+
+// What each pair of a bank costs, as a share of a Gemini with one voice.
+void benchmarkPairs(const Options& options) {
+  std::printf("%-9s %-6s %-5s %10s %10s %10s\n", "mode", "filter", "pairs",
+              "ns/sample", "ns/pair", "vs gemini");
+  for (int mode = 0; mode < Gemini::MODES_LEN; mode++) {
+    for (bool filter : {false, true}) {
+      const double gemini =
+          benchmarkGemini(options, static_cast<Gemini::Mode>(mode), false,
+                          filter, MONO)
+              .nanosecondsPerSample;
+      for (int pairs : {1, 2, 4, 8}) {
+        const double bank =
+            benchmarkBank(options, pairs, static_cast<Gemini::Mode>(mode),
+                          filter)
+                .nanosecondsPerSample;
+        std::printf("%-9s %-6s %-5d %10.1f %10.1f %9.2fx\n", MODE_NAMES[mode],
+                    filter ? "on" : "off", pairs, bank, bank / pairs,
+                    bank / pairs / gemini);
+      }
+    }
+  }
+}
+
+// What each unison copy of a single voice costs, against a Gemini per copy.
+void benchmarkUnison(const Options& options) {
+  std::printf("%-9s %-6s %-6s %10s %10s %10s\n", "mode", "filter", "copies",
+              "ns/sample", "ns/copy", "vs stack");
+  for (int mode = 0; mode < Gemini::MODES_LEN; mode++) {
+    for (bool filter : {false, true}) {
+      const double gemini =
+          benchmarkGemini(options, static_cast<Gemini::Mode>(mode), false,
+                          filter, MONO)
+              .nanosecondsPerSample;
+      for (int copies : {2, 4, 8, 16}) {
+        const double unison =
+            benchmarkGemini(options, static_cast<Gemini::Mode>(mode), false,
+                            filter, MONO, ALL_OUTPUTS, Gemini::supportedIsa(),
+                            copies)
+                .nanosecondsPerSample;
+        std::printf("%-9s %-6s %-6d %10.1f %10.1f %9.2fx\n", MODE_NAMES[mode],
+                    filter ? "on" : "off", copies, unison, unison / copies,
+                    unison / (copies * gemini));
+      }
+    }
+  }
+}
+
+bool parseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    if (!std::strcmp(argv[i], "-b")) {
+      options->bandLimited = true;
+    } else if (!std::strcmp(argv[i], "-i")) {
+      options->isas = true;
+    } else if (!std::strcmp(argv[i], "-p")) {
+      options->pairs = true;
+    } else if (!std::strcmp(argv[i], "-u")) {
+      options->unison = true;
+    } else if (!std::strcmp(argv[i], "-o") && i + 1 < argc) {
+      options->oversampling = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "-f") && i + 1 < argc) {
+      options->frames = std::atoi(argv[++i]);
+    } else {
+      return false;
+    }
+  }
+  const int oversampling = options->oversampling;
+  return options->frames > 0 && oversampling > 0 &&
+         oversampling <= Gemini::MAX_OVERSAMPLING &&
+         (oversampling & (oversampling - 1)) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, &options)) {
+    std::fprintf(stderr,
+                 "usage: %s [-b] [-i] [-p] [-u] [-o 1|2|4|8] [-f frames]\n",
+                 argv[0]);
+    return 1;
+  }
+  flushDenormals();
+  for (int i = 0; i < MODULATION_LEN; i++) {
+    modulation[i] = 0.05f * std::sin(2.f * M_PI * i / MODULATION_LEN);
+  }
+
+  std::printf("%d frames at %.0f Hz, band-limited %s, %dx oversampling\n\n",
+              options.frames, SAMPLE_RATE, options.bandLimited ? "on" : "off",
+              options.oversampling);
+  if (options.isas) {
+    benchmarkIsas(options);
+    return 0;
+  }
+  if (options.pairs) {
+    benchmarkPairs(options);
+    return 0;
+  }
+  if (options.unison) {
+    benchmarkUnison(options);
+    return 0;
+  }
+  std::printf("%-9s %-3s %-6s %-6s %10s %12s %10s\n", "mode", "alt", "filter",
+              "inputs", "ns/sample", "samples/s", "realtime");
+  if (options.bandLimited) {
+    benchmarkOscillator<false, true>(options);
+    benchmarkOscillator<true, true>(options);
+  } else {
+    benchmarkOscillator<false, false>(options);
+    benchmarkOscillator<true, false>(options);
+  }
+  for (int mode = 0; mode < Gemini::MODES_LEN; mode++) {
+    for (bool alt : {false, true}) {
+      for (bool filter : {false, true}) {
+        for (int inputs = 0; inputs < INPUTS_LEN; inputs++) {
+          const Result result =
+              benchmarkGemini(options, static_cast<Gemini::Mode>(mode), alt,
+                              filter, static_cast<Inputs>(inputs));
+          std::printf("%-9s %-3s %-6s %-6s ", MODE_NAMES[mode],
+                      alt ? "on" : "off", filter ? "on" : "off",
+                      INPUT_NAMES[inputs]);
+          printResult(result);
+        }
+      }
+    }
+  }
+
+  // Unconnected outputs skip the oscillators only they hear.
+  std::printf("\n%-9s %-7s %-6s %10s %12s %10s\n", "mode", "outputs",
+              "inputs", "ns/sample", "samples/s", "realtime");
+  for (int mode = 0; mode < Gemini::MODES_LEN; mode++) {
+    for (int set = 0; set < static_cast<int>(std::size(OUTPUT_SETS)); set++) {
+      const Result result =
+          benchmarkGemini(options, static_cast<Gemini::Mode>(mode), false,
+                          true, POLY, OUTPUT_SETS[set]);
+      std::printf("%-9s %-7s %-6s ", MODE_NAMES[mode], OUTPUT_SET_NAMES[set],
+                  INPUT_NAMES[POLY]);
+      printResult(result);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+// The patch shared by the benchmarks and renders: Gemini in a given mode, with
+// its pitch, duty and level knobs away from their defaults.
+#include "Gemini.cpp"
+#include "GeminiBank.cpp"
+
+constexpr float SAMPLE_RATE = 48000.f;
+
+constexpr const char* MODE_NAMES[Gemini::MODES_LEN] = {"chorus", "lfo-pwm",
+                                                       "lfo-fm", "hard-sync"};
+
+// Rack's engine threads run with denormals flushed to zero (FTZ and DAZ), so
+// the benchmarks do too.
+inline void flushDenormals() { _mm_setcsr(_mm_getcsr() | 0x8040); }
+
+// Sets up gemini and processes the frames needed for the settings to apply.
+inline void setUpPatch(Gemini& gemini, Module::ProcessArgs& args,
+                       Gemini::Mode mode, bool alt, bool filter,
+                       bool bandLimited, int oversampling) {
+  gemini.bandLimited = bandLimited;
+  gemini.oversampling = oversampling;
+  gemini.onSampleRateChange({args.sampleRate, args.sampleTime});
+  for (Output& output : gemini.outputs) {
+    output.channels = 1;
+  }
+
+  // Switching mode loads that mode's stored params, so it has to land before
+  // the rest are set.
+  gemini.params[Gemini::BUTTON_PARAM].setValue(mode);
+  gemini.params[Gemini::ALT_MODE_BUTTON_PARAM].setValue(alt);
+  // Knobs are read when a block is rendered, so finish the block first.
+  do {
+    gemini.process(args);
+    args.frame++;
+  } while (args.frame % BLOCK_SIZE != 0);
+
+  gemini.params[Gemini::FILTER_ENABLE_BUTTON_PARAM].setValue(filter);
+  gemini.params[Gemini::CASTOR_PITCH_PARAM].setValue(0.1f);
+  gemini.params[Gemini::POLLUX_PITCH_PARAM].setValue(0.25f);
+  gemini.params[Gemini::LFO_PARAM].setValue(0.5f);
+  gemini.params[Gemini::CASTOR_DUTY_PARAM].setValue(0.3f);
+  gemini.params[Gemini::POLLUX_DUTY_PARAM].setValue(0.6f);
+  gemini.params[Gemini::CASTOR_RAMP_LEVEL_PARAM].setValue(0.7f);
+  gemini.params[Gemini::CASTOR_PULSE_LEVEL_PARAM].setValue(0.5f);
+  gemini.params[Gemini::CASTOR_SUB_LEVEL_PARAM].setValue(0.3f);
+  gemini.params[Gemini::POLLUX_RAMP_LEVEL_PARAM].setValue(0.4f);
+  gemini.params[Gemini::POLLUX_PULSE_LEVEL_PARAM].setValue(0.6f);
+  gemini.params[Gemini::POLLUX_SUB_LEVEL_PARAM].setValue(0.2f);
+  // The new params are picked up when the block is rendered, then the smoothed
+  // ones take up to SLEW_TIME to arrive.
+  const int slewBlocks = static_cast<int>(
+      std::ceil(Gemini::SLEW_TIME * args.sampleRate / BLOCK_SIZE));
+  for (int frame = 0; frame < (1 + slewBlocks) * BLOCK_SIZE; frame++) {
+    gemini.process(args);
+    args.frame++;
+  }
+}
@@ -0,0 +1,866 @@
+#pragma once
+// A minimal stand-in for the parts of the Rack SDK used by the benchmarks, so
+// they build without Rack. rack::simd mirrors the SSE layout of the real
+// thing, and the engine types behave like Rack's for everything the DSP code
+// touches. Widgets, menus and models only need to compile.
+#include <pmmintrin.h>
+#include <smmintrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Just enough of jansson for patch storage round trips: objects keep their
+// keys in insertion order.
+enum json_type {
+  JSON_OBJECT,
+  JSON_ARRAY,
+  JSON_STRING,
+  JSON_INTEGER,
+  JSON_REAL,
+  JSON_TRUE,
+  JSON_FALSE,
+  JSON_NULL
+};
+
+struct json_t {
+  json_type type;
+  double number = 0.0;
+  std::string string;
+  std::vector<std::pair<std::string, json_t*>> object;
+  std::vector<json_t*> array;
+};
+
+inline json_t* json_new(json_type type) {
+  json_t* json = new json_t;
+  json->type = type;
+  return json;
+}
+inline json_t* json_object() { return json_new(JSON_OBJECT); }
+inline json_t* json_array() { return json_new(JSON_ARRAY); }
+inline json_t* json_null() { return json_new(JSON_NULL); }
+inline json_t* json_boolean(bool value) {
+  return json_new(value ? JSON_TRUE : JSON_FALSE);
+}
+inline json_t* json_real(double value) {
+  json_t* json = json_new(JSON_REAL);
+  json->number = value;
+  return json;
+}
+inline json_t* json_integer(long long value) {
+  json_t* json = json_new(JSON_INTEGER);
+  json->number = value;
+  return json;
+}
+inline json_t* json_string(const char* value) {
+  json_t* json = json_new(JSON_STRING);
+  json->string = value;
+  return json;
+}
+
+inline void json_decref(json_t* json) {
+  if (!json) {
+    return;
+  }
+  for (auto& [key, value] : json->object) {
+    json_decref(value);
+  }
+  for (json_t* value : json->array) {
+    json_decref(value);
+  }
+  delete json;
+}
+
+inline bool json_is_object(const json_t* json) {
+  return json && json->type == JSON_OBJECT;
+}
+inline bool json_is_array(const json_t* json) {
+  return json && json->type == JSON_ARRAY;
+}
+inline bool json_is_string(const json_t* json) {
+  return json && json->type == JSON_STRING;
+}
+inline bool json_is_integer(const json_t* json) {
+  return json && json->type == JSON_INTEGER;
+}
+inline bool json_is_real(const json_t* json) {
+  return json && json->type == JSON_REAL;
+}
+inline bool json_is_number(const json_t* json) {
+  return json_is_integer(json) || json_is_real(json);
+}
+inline bool json_is_boolean(const json_t* json) {
+  return json && (json->type == JSON_TRUE || json->type == JSON_FALSE);
+}
+inline bool json_is_true(const json_t* json) {
+  return json && json->type == JSON_TRUE;
+}
+
+inline bool json_boolean_value(const json_t* json) {
+  return json_is_true(json);
+}
+inline double json_number_value(const json_t* json) {
+  return json_is_number(json) ? json->number : 0.0;
+}
+inline double json_real_value(const json_t* json) {
+  return json_is_real(json) ? json->number : 0.0;
+}
+inline long long json_integer_value(const json_t* json) {
+  return json_is_integer(json) ? static_cast<long long>(json->number) : 0;
+}
+inline const char* json_string_value(const json_t* json) {
+  return json_is_string(json) ? json->string.c_str() : nullptr;
+}
+
+inline size_t json_array_size(const json_t* json) {
+  return json_is_array(json) ? json->array.size() : 0;
+}
+inline json_t* json_array_get(const json_t* json, size_t index) {
+  return index < json_array_size(json) ? json->array[index] : nullptr;
+}
+inline int json_array_append_new(json_t* json, json_t* value) {
+  json->array.push_back(value);
+  return 0;
+}
+
+inline size_t json_object_size(const json_t* json) {
+  return json_is_object(json) ? json->object.size() : 0;
+}
+inline json_t* json_object_get(const json_t* json, const char* key) {
+  if (!json_is_object(json)) {
+    return nullptr;
+  }
+  for (const auto& [k, value] : json->object) {
+    if (k == key) {
+      return value;
+    }
+  }
+  return nullptr;
+}
+inline int json_object_set_new(json_t* json, const char* key, json_t* value) {
+  for (auto& [k, v] : json->object) {
+    if (k == key) {
+      json_decref(v);
+      v = value;
+      return 0;
+    }
+  }
+  json->object.emplace_back(key, value);
+  return 0;
+}
+inline const char* json_object_key_at(const json_t* json, size_t index) {
+  return index < json_object_size(json) ? json->object[index].first.c_str()
+                                        : nullptr;
+}
+inline json_t* json_object_value_at(const json_t* json, size_t index) {
+  return index < json_object_size(json) ? json->object[index].second
+                                        : nullptr;
+}
+
+#define json_object_foreach(object, key, value)            \
+  for (size_t json_index = 0;                              \
+       (key = json_object_key_at(object, json_index)) &&   \
+       (value = json_object_value_at(object, json_index)); \
+       json_index++)
+
+namespace rack {
+namespace simd {
+
+template <typename T, int N>
+struct Vector;
+
+template <>
+struct Vector<float, 4> {
+  using type = float;
+  constexpr static int size = 4;
+
+  union {
+    __m128 v;
+    float s[4];
+  };
+
+  Vector() = default;
+  Vector(__m128 v) : v(v) {}
+  Vector(float x) { v = _mm_set1_ps(x); }
+  Vector(float x1, float x2, float x3, float x4) {
+    v = _mm_setr_ps(x1, x2, x3, x4);
+  }
+  inline Vector(Vector<int32_t, 4> a);
+
+  float& operator[](int i) { return s[i]; }
+  const float& operator[](int i) const { return s[i]; }
+
+  static Vector zero() { return Vector(_mm_setzero_ps()); }
+  static Vector mask() { return Vector(_mm_castsi128_ps(_mm_set1_epi32(-1))); }
+  static Vector load(const float* x) { return Vector(_mm_loadu_ps(x)); }
+  void store(float* x) { _mm_storeu_ps(x, v); }
+  static inline Vector cast(Vector<int32_t, 4> a);
+};
+
+template <>
+struct Vector<int32_t, 4> {
+  using type = int32_t;
+  constexpr static int size = 4;
+
+  union {
+    __m128i v;
+    int32_t s[4];
+  };
+
+  Vector() = default;
+  Vector(__m128i v) : v(v) {}
+  Vector(int32_t x) { v = _mm_set1_epi32(x); }
+  Vector(int32_t x1, int32_t x2, int32_t x3, int32_t x4) {
+    v = _mm_setr_epi32(x1, x2, x3, x4);
+  }
+  Vector(Vector<float, 4> a) { v = _mm_cvttps_epi32(a.v); }
+
+  int32_t& operator[](int i) { return s[i]; }
+  const int32_t& operator[](int i) const { return s[i]; }
+
+  static Vector zero() { return Vector(_mm_setzero_si128()); }
+  static Vector load(const int32_t* x) {
+    return Vector(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x)));
+  }
+  void store(int32_t* x) { _mm_storeu_si128(reinterpret_cast<__m128i*>(x), v); }
+  static Vector cast(Vector<float, 4> a) {
+    return Vector(_mm_castps_si128(a.v));
+  }
+};
+
+inline Vector<float, 4>::Vector(Vector<int32_t, 4> a) {
+  v = _mm_cvtepi32_ps(a.v);
+}
+
+inline Vector<float, 4> Vector<float, 4>::cast(Vector<int32_t, 4> a) {
+  return Vector(_mm_castsi128_ps(a.v));
+}
+
+using float_4 = Vector<float, 4>;
+using int32_4 = Vector<int32_t, 4>;
+
+#define DECLARE_FLOAT_4_OPERATOR(op, intrinsic)  \
+  inline float_4 operator op(float_4 a, float_4 b) { \
+    return intrinsic(a.v, b.v);                      \
+  }
+DECLARE_FLOAT_4_OPERATOR(+, _mm_add_ps)
+DECLARE_FLOAT_4_OPERATOR(-, _mm_sub_ps)
+DECLARE_FLOAT_4_OPERATOR(*, _mm_mul_ps)
+DECLARE_FLOAT_4_OPERATOR(/, _mm_div_ps)
+DECLARE_FLOAT_4_OPERATOR(&, _mm_and_ps)
+DECLARE_FLOAT_4_OPERATOR(|, _mm_or_ps)
+DECLARE_FLOAT_4_OPERATOR(^, _mm_xor_ps)
+DECLARE_FLOAT_4_OPERATOR(==, _mm_cmpeq_ps)
+DECLARE_FLOAT_4_OPERATOR(!=, _mm_cmpneq_ps)
+DECLARE_FLOAT_4_OPERATOR(<, _mm_cmplt_ps)
+DECLARE_FLOAT_4_OPERATOR(<=, _mm_cmple_ps)
+DECLARE_FLOAT_4_OPERATOR(>, _mm_cmpgt_ps)
+DECLARE_FLOAT_4_OPERATOR(>=, _mm_cmpge_ps)
+#undef DECLARE_FLOAT_4_OPERATOR
+
+#define DECLARE_INT32_4_OPERATOR(op, intrinsic)  \
+  inline int32_4 operator op(int32_4 a, int32_4 b) { \
+    return intrinsic(a.v, b.v);                      \
+  }
+DECLARE_INT32_4_OPERATOR(+, _mm_add_epi32)
+DECLARE_INT32_4_OPERATOR(-, _mm_sub_epi32)
+DECLARE_INT32_4_OPERATOR(&, _mm_and_si128)
+DECLARE_INT32_4_OPERATOR(|, _mm_or_si128)
+DECLARE_INT32_4_OPERATOR(^, _mm_xor_si128)
+DECLARE_INT32_4_OPERATOR(==, _mm_cmpeq_epi32)
+DECLARE_INT32_4_OPERATOR(>, _mm_cmpgt_epi32)
+DECLARE_INT32_4_OPERATOR(<, _mm_cmplt_epi32)
+#undef DECLARE_INT32_4_OPERATOR
+
+inline float_4 operator+(float_4 a) { return a; }
+inline float_4 operator-(float_4 a) { return 0.f - a; }
+inline float_4 operator~(float_4 a) { return a ^ float_4::mask(); }
+inline float_4& operator+=(float_4& a, float_4 b) { return a = a + b; }
+inline float_4& operator-=(float_4& a, float_4 b) { return a = a - b; }
+inline float_4& operator*=(float_4& a, float_4 b) { return a = a * b; }
+inline float_4& operator/=(float_4& a, float_4 b) { return a = a / b; }
+inline float_4& operator&=(float_4& a, float_4 b) { return a = a & b; }
+inline float_4& operator|=(float_4& a, float_4 b) { return a = a | b; }
+inline int32_4 operator*(int32_4 a, int32_4 b) {
+  return _mm_mullo_epi32(a.v, b.v);
+}
+inline int32_4 operator~(int32_4 a) { return a ^ int32_4(-1); }
+inline int32_4& operator+=(int32_4& a, int32_4 b) { return a = a + b; }
+inline int32_4& operator-=(int32_4& a, int32_4 b) { return a = a - b; }
+inline int32_4 operator<<(int32_4 a, int b) { return _mm_slli_epi32(a.v, b); }
+inline int32_4 operator>>(int32_4 a, int b) { return _mm_srai_epi32(a.v, b); }
+
+// Scalar versions, so templated code can call simd:: for float and float_4.
+using std::ceil;
+using std::cos;
+using std::exp;
+using std::exp2;
+using std::fabs;
+using std::floor;
+using std::fmax;
+using std::fmin;
+using std::log;
+using std::log2;
+using std::pow;
+using std::round;
+using std::sin;
+using std::sqrt;
+using std::tan;
+using std::trunc;
+
+inline float ifelse(bool mask, float a, float b) { return mask ? a : b; }
+inline float clamp(float x, float a = 0.f, float b = 1.f) {
+  return std::fmax(std::fmin(x, b), a);
+}
+inline float crossfade(float a, float b, float p) { return a + (b - a) * p; }
+inline int movemask(bool mask) { return mask; }
+
+inline float_4 ifelse(float_4 mask, float_4 a, float_4 b) {
+  return _mm_blendv_ps(b.v, a.v, mask.v);
+}
+inline int movemask(float_4 a) { return _mm_movemask_ps(a.v); }
+inline float_4 fmax(float_4 a, float_4 b) { return _mm_max_ps(a.v, b.v); }
+inline float_4 fmin(float_4 a, float_4 b) { return _mm_min_ps(a.v, b.v); }
+inline float_4 clamp(float_4 x, float_4 a = 0.f, float_4 b = 1.f) {
+  return fmin(fmax(x, a), b);
+}
+inline float_4 crossfade(float_4 a, float_4 b, float_4 p) {
+  return a + (b - a) * p;
+}
+inline float_4 fabs(float_4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a.v); }
+inline float_4 sqrt(float_4 a) { return _mm_sqrt_ps(a.v); }
+inline float_4 floor(float_4 a) { return _mm_floor_ps(a.v); }
+inline float_4 ceil(float_4 a) { return _mm_ceil_ps(a.v); }
+inline float_4 round(float_4 a) {
+  return _mm_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+inline float_4 trunc(float_4 a) {
+  return _mm_round_ps(a.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+}
+
+// Like Rack, transcendental functions fall back to the scalar versions.
+#define DECLARE_FLOAT_4_FUNCTION(f)                                \
+  inline float_4 f(float_4 a) {                                    \
+    return float_4(std::f(a[0]), std::f(a[1]), std::f(a[2]),       \
+                   std::f(a[3]));                                  \
+  }
+DECLARE_FLOAT_4_FUNCTION(cos)
+DECLARE_FLOAT_4_FUNCTION(exp)
+DECLARE_FLOAT_4_FUNCTION(exp2)
+DECLARE_FLOAT_4_FUNCTION(log)
+DECLARE_FLOAT_4_FUNCTION(log2)
+DECLARE_FLOAT_4_FUNCTION(sin)
+DECLARE_FLOAT_4_FUNCTION(tan)
+#undef DECLARE_FLOAT_4_FUNCTION
+
+inline float_4 pow(float_4 a, float_4 b) {
+  return float_4(std::pow(a[0], b[0]), std::pow(a[1], b[1]),
+                 std::pow(a[2], b[2]), std::pow(a[3], b[3]));
+}
+inline float_4 pow(float a, float_4 b) { return pow(float_4(a), b); }
+
+}  // namespace simd
+
+namespace math {
+
+inline int clamp(int x, int a, int b) { return std::max(std::min(x, b), a); }
+inline float clamp(float x, float a = 0.f, float b = 1.f) {
+  return std::fmax(std::fmin(x, b), a);
+}
+inline float crossfade(float a, float b, float p) { return a + (b - a) * p; }
+inline float rescale(float x, float xMin, float xMax, float yMin, float yMax) {
+  return yMin + (x - xMin) / (xMax - xMin) * (yMax - yMin);
+}
+inline bool isNear(float a, float b, float epsilon = 1e-6f) {
+  return std::fabs(a - b) <= epsilon;
+}
+
+struct Vec {
+  float x = 0.f;
+  float y = 0.f;
+
+  Vec() {}
+  Vec(float x, float y) : x(x), y(y) {}
+  Vec plus(Vec b) const { return Vec(x + b.x, y + b.y); }
+  Vec minus(Vec b) const { return Vec(x - b.x, y - b.y); }
+};
+
+struct Rect {
+  Vec pos;
+  Vec size;
+};
+
+}  // namespace math
+
+using math::Rect;
+using math::Vec;
+
+namespace random {
+
+// Rack seeds a generator per thread; a fixed seed keeps runs repeatable.
+inline uint32_t u32() {
+  static thread_local uint32_t state = 0x9e3779b9u;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+inline float uniform() { return (u32() >> 8) * 0x1p-24f; }
+
+}  // namespace random
+
+namespace dsp {
+
+static constexpr float FREQ_C4 = 261.6256f;
+
+// Same coefficients and state layout as Rack's dsp::TBiquadFilter.
+template <typename T = float>
+struct TBiquadFilter {
+  T x[2];
+  T y[2];
+  float b[3];
+  float a[2];
+
+  enum Type {
+    LOWPASS_1POLE,
+    HIGHPASS_1POLE,
+    LOWPASS,
+    HIGHPASS,
+    LOWSHELF,
+    HIGHSHELF,
+    BANDPASS,
+    PEAK,
+    NOTCH,
+    NUM_TYPES
+  };
+
+  TBiquadFilter() {
+    reset();
+    setParameters(LOWPASS, 0.f, 0.f, 1.f);
+  }
+
+  void reset() {
+    x[0] = x[1] = 0.f;
+    y[0] = y[1] = 0.f;
+  }
+
+  T process(T in) {
+    T out = b[0] * in + b[1] * x[0] + b[2] * x[1] - a[0] * y[0] - a[1] * y[1];
+    x[1] = x[0];
+    x[0] = in;
+    y[1] = y[0];
+    y[0] = out;
+    return out;
+  }
+
+  void setParameters(Type type, float f, float Q, float V) {
+    const float K = std::tan(M_PI * f);
+    switch (type) {
+      case LOWPASS_1POLE:
+        a[0] = -std::exp(-2.f * M_PI * f);
+        a[1] = 0.f;
+        b[0] = 1.f + a[0];
+        b[1] = 0.f;
+        b[2] = 0.f;
+        break;
+      case HIGHPASS_1POLE:
+        a[0] = std::exp(-2.f * M_PI * (0.5f - f));
+        a[1] = 0.f;
+        b[0] = 1.f - a[0];
+        b[1] = 0.f;
+        b[2] = 0.f;
+        break;
+      case LOWPASS: {
+        const float norm = 1.f / (1.f + K / Q + K * K);
+        b[0] = K * K * norm;
+        b[1] = 2.f * b[0];
+        b[2] = b[0];
+        a[0] = 2.f * (K * K - 1.f) * norm;
+        a[1] = (1.f - K / Q + K * K) * norm;
+      } break;
+      case HIGHPASS: {
+        const float norm = 1.f / (1.f + K / Q + K * K);
+        b[0] = norm;
+        b[1] = -2.f * b[0];
+        b[2] = b[0];
+        a[0] = 2.f * (K * K - 1.f) * norm;
+        a[1] = (1.f - K / Q + K * K) * norm;
+      } break;
+      default:
+        break;
+    }
+  }
+};
+
+typedef TBiquadFilter<> BiquadFilter;
+
+}  // namespace dsp
+
+namespace engine {
+
+struct Module;
+
+struct Param {
+  float value = 0.f;
+
+  float getValue() { return value; }
+  void setValue(float value) { this->value = value; }
+};
+
+struct Port {
+  union {
+    float voltages[16] = {};
+    float value;
+  };
+  uint8_t channels = 0;
+
+  void setVoltage(float voltage, int channel = 0) {
+    voltages[channel] = voltage;
+  }
+  float getVoltage(int channel = 0) { return voltages[channel]; }
+  float getPolyVoltage(int channel) {
+    return isMonophonic() ? getVoltage(0) : getVoltage(channel);
+  }
+  float getNormalVoltage(float normalVoltage, int channel = 0) {
+    return isConnected() ? getVoltage(channel) : normalVoltage;
+  }
+  float getNormalPolyVoltage(float normalVoltage, int channel) {
+    return isConnected() ? getPolyVoltage(channel) : normalVoltage;
+  }
+
+  template <typename T>
+  T getVoltageSimd(int firstChannel) {
+    return T::load(&voltages[firstChannel]);
+  }
+  template <typename T>
+  T getPolyVoltageSimd(int firstChannel) {
+    return isMonophonic() ? T(getVoltage(0)) : getVoltageSimd<T>(firstChannel);
+  }
+  template <typename T>
+  T getNormalPolyVoltageSimd(T normalVoltage, int firstChannel) {
+    return isConnected() ? getPolyVoltageSimd<T>(firstChannel) : normalVoltage;
+  }
+  template <typename T>
+  void setVoltageSimd(T voltage, int firstChannel) {
+    voltage.store(&voltages[firstChannel]);
+  }
+
+  // Rack keeps unconnected ports at zero channels.
+  void setChannels(int channels) {
+    if (this->channels == 0) {
+      return;
+    }
+    if (channels == 0) {
+      channels = 1;
+      voltages[0] = 0.f;
+    }
+    this->channels = channels;
+  }
+  int getChannels() { return channels; }
+  bool isConnected() { return channels > 0; }
+  bool isMonophonic() { return channels == 1; }
+  bool isPolyphonic() { return channels > 1; }
+};
+
+struct Input : Port {};
+struct Output : Port {};
+
+struct Light {
+  float value = 0.f;
+
+  void setBrightness(float brightness) { value = brightness; }
+};
+
+struct Quantity {
+  virtual ~Quantity() {}
+  virtual std::string getLabel() { return ""; }
+};
+
+struct ParamQuantity : Quantity {
+  Module* module = nullptr;
+  int paramId = -1;
+  float minValue = 0.f;
+  float maxValue = 1.f;
+  float defaultValue = 0.f;
+  std::string name;
+  std::string unit;
+  bool snapEnabled = false;
+
+  virtual float getMinValue() { return minValue; }
+  virtual float getMaxValue() { return maxValue; }
+  std::string getLabel() override { return name; }
+};
+
+struct PortInfo {
+  std::string name;
+};
+
+struct Module {
+  std::vector<Param> params;
+  std::vector<Input> inputs;
+  std::vector<Output> outputs;
+  std::vector<Light> lights;
+  std::vector<std::unique_ptr<ParamQuantity>> paramQuantities;
+  std::vector<std::unique_ptr<PortInfo>> inputInfos;
+  std::vector<std::unique_ptr<PortInfo>> outputInfos;
+
+  struct ProcessArgs {
+    float sampleRate;
+    float sampleTime;
+    int64_t frame;
+  };
+  struct SampleRateChangeEvent {
+    float sampleRate;
+    float sampleTime;
+  };
+  struct ResetEvent {};
+
+  virtual ~Module() {}
+
+  void config(int numParams, int numInputs, int numOutputs, int numLights) {
+    params.resize(numParams);
+    inputs.resize(numInputs);
+    outputs.resize(numOutputs);
+    lights.resize(numLights);
+    paramQuantities.resize(numParams);
+    inputInfos.resize(numInputs);
+    outputInfos.resize(numOutputs);
+  }
+
+  template <class TParamQuantity = ParamQuantity>
+  TParamQuantity* configParam(int paramId, float minValue, float maxValue,
+                              float defaultValue, std::string name = "",
+                              std::string unit = "", float displayBase = 0.f,
+                              float displayMultiplier = 1.f,
+                              float displayOffset = 0.f) {
+    TParamQuantity* q = new TParamQuantity;
+    q->module = this;
+    q->paramId = paramId;
+    q->minValue = minValue;
+    q->maxValue = maxValue;
+    q->defaultValue = defaultValue;
+    q->name = name;
+    q->unit = unit;
+    paramQuantities[paramId].reset(q);
+    params[paramId].value = defaultValue;
+    return q;
+  }
+
+  template <class TParamQuantity = ParamQuantity>
+  TParamQuantity* configSwitch(int paramId, float minValue, float maxValue,
+                               float defaultValue, std::string name = "",
+                               std::vector<std::string> labels = {}) {
+    TParamQuantity* q = configParam<TParamQuantity>(paramId, minValue, maxValue,
+                                                    defaultValue, name);
+    q->snapEnabled = true;
+    return q;
+  }
+
+  PortInfo* configInput(int portId, std::string name = "") {
+    inputInfos[portId].reset(new PortInfo{name});
+    return inputInfos[portId].get();
+  }
+
+  PortInfo* configOutput(int portId, std::string name = "") {
+    outputInfos[portId].reset(new PortInfo{name});
+    return outputInfos[portId].get();
+  }
+
+  ParamQuantity* getParamQuantity(int paramId) {
+    return paramQuantities[paramId].get();
+  }
+
+  virtual void process(const ProcessArgs& args) {}
+  virtual void onSampleRateChange(const SampleRateChangeEvent& e) {}
+  virtual void onReset(const ResetEvent& e) {}
+  virtual json_t* dataToJson() { return nullptr; }
+  virtual void dataFromJson(json_t* rootJ) {}
+};
+
+}  // namespace engine
+
+using engine::Input;
+using engine::Module;
+using engine::Output;
+using engine::Param;
+using engine::ParamQuantity;
+
+
+namespace ui {
+
+struct MenuItem {
+  std::string text;
+  std::string rightText;
+
+  virtual ~MenuItem() {}
+};
+
+struct MenuSeparator : MenuItem {};
+struct MenuLabel : MenuItem {};
+
+struct Menu {
+  std::vector<std::unique_ptr<MenuItem>> children;
+
+  void addChild(MenuItem* item) { children.emplace_back(item); }
+};
+
+}  // namespace ui
+
+using ui::Menu;
+using ui::MenuItem;
+using ui::MenuLabel;
+using ui::MenuSeparator;
+
+namespace widget {
+
+struct Widget {
+  math::Rect box;
+  std::vector<std::unique_ptr<Widget>> children;
+
+  virtual ~Widget() {}
+  virtual void step() {}
+  void addChild(Widget* child) { children.emplace_back(child); }
+};
+
+}  // namespace widget
+
+namespace app {
+
+struct SvgPanel : widget::Widget {};
+struct ParamWidget : widget::Widget {};
+struct PortWidget : widget::Widget {};
+
+struct ModuleWidget : widget::Widget {
+  engine::Module* module = nullptr;
+
+  void setModule(engine::Module* module) { this->module = module; }
+  engine::Module* getModule() { return module; }
+  template <class TModule>
+  TModule* getModule() {
+    return dynamic_cast<TModule*>(module);
+  }
+  void setPanel(widget::Widget* panel) { addChild(panel); }
+  void addParam(ParamWidget* param) { addChild(param); }
+  void addInput(PortWidget* input) { addChild(input); }
+  void addOutput(PortWidget* output) { addChild(output); }
+  virtual void appendContextMenu(ui::Menu* menu) {}
+};
+
+}  // namespace app
+
+using app::ModuleWidget;
+
+static constexpr float RACK_GRID_WIDTH = 15;
+static constexpr float RACK_GRID_HEIGHT = 380;
+
+inline Vec mm2px(Vec mm) {
+  return Vec(mm.x * 75.f / 25.4f, mm.y * 75.f / 25.4f);
+}
+
+struct ScrewSilver : widget::Widget {};
+struct RoundHugeBlackKnob : app::ParamWidget {};
+struct RoundBigBlackKnob : app::ParamWidget {};
+struct RoundLargeBlackKnob : app::ParamWidget {};
+struct RoundBlackKnob : app::ParamWidget {};
+struct RoundBlackSnapKnob : app::ParamWidget {};
+struct RoundSmallBlackKnob : app::ParamWidget {};
+struct Trimpot : app::ParamWidget {};
+struct VCVButton : app::ParamWidget {};
+struct VCVLatch : app::ParamWidget {};
+struct PJ301MPort : app::PortWidget {};
+
+template <class TWidget>
+TWidget* createWidget(Vec pos) {
+  TWidget* widget = new TWidget;
+  widget->box.pos = pos;
+  return widget;
+}
+template <class TParamWidget>
+TParamWidget* createParamCentered(Vec pos, engine::Module* module, int id) {
+  return createWidget<TParamWidget>(pos);
+}
+template <class TPortWidget>
+TPortWidget* createInputCentered(Vec pos, engine::Module* module, int id) {
+  return createWidget<TPortWidget>(pos);
+}
+template <class TPortWidget>
+TPortWidget* createOutputCentered(Vec pos, engine::Module* module, int id) {
+  return createWidget<TPortWidget>(pos);
+}
+inline widget::Widget* createPanel(std::string svgPath) {
+  return new app::SvgPanel;
+}
+
+template <class TMenuItem = ui::MenuItem>
+TMenuItem* createMenuItem(std::string text, std::string rightText = "",
+                          std::function<void()> action = nullptr) {
+  TMenuItem* item = new TMenuItem;
+  item->text = text;
+  item->rightText = rightText;
+  return item;
+}
+template <class TMenuLabel = ui::MenuLabel>
+TMenuLabel* createMenuLabel(std::string text) {
+  return createMenuItem<TMenuLabel>(text);
+}
+inline ui::MenuItem* createBoolMenuItem(std::string text, std::string rightText,
+                                        std::function<bool()> getter,
+                                        std::function<void(bool)> setter) {
+  return createMenuItem(text, rightText);
+}
+inline ui::MenuItem* createBoolPtrMenuItem(std::string text,
+                                           std::string rightText, bool* ptr) {
+  return createMenuItem(text, rightText);
+}
+inline ui::MenuItem* createIndexSubmenuItem(
+    std::string text, std::vector<std::string> labels,
+    std::function<size_t()> getter, std::function<void(size_t)> setter) {
+  return createMenuItem(text);
+}
+
+namespace plugin {
+
+struct Model {
+  std::string slug;
+
+  virtual ~Model() {}
+  virtual engine::Module* createModule() = 0;
+};
+
+struct Plugin {
+  std::vector<Model*> models;
+
+  void addModel(Model* model) { models.push_back(model); }
+};
+
+}  // namespace plugin
+
+using plugin::Model;
+using plugin::Plugin;
+
+template <class TModule, class TModuleWidget>
+plugin::Model* createModel(std::string slug) {
+  struct TModel : plugin::Model {
+    engine::Module* createModule() override { return new TModule; }
+  };
+  TModel* model = new TModel;
+  model->slug = slug;
+  return model;
+}
+
+namespace asset {
+
+inline std::string plugin(plugin::Plugin* plugin, std::string filename) {
+  return filename;
+}
+
+}  // namespace asset
+
+}  // namespace rack
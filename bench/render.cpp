@@ -0,0 +1,654 @@
+// Renders fixed-length buffers of every Gemini output in every mode, alt mode
+// and filter setting, then in each mode with CV and with a polyphonic cable
+// patched, plus each oscillator waveform on its own, and reports how much the
+// waveforms alias. With -w the buffers are written to a directory; with -c
+// they are checked against a directory written earlier, e.g. from the commit
+// before a refactor, sample by sample and by spectrum. With -s and -g, a
+// summary of each buffer small enough to commit is written or checked, which
+// is how `make run` catches changes to the sound.
+//
+// usage: render [-b] [-o oversampling] [-w dir | -c dir] [-t tolerance]
+//               [-s file | -g file]
+//   -b  band-limited waveforms
+//   -o  oversampling factor (1, 2, 4 or 8)
+//   -w  write the buffers to dir
+//   -c  compare against the buffers in dir, failing on any difference over
+//       the tolerance
+//   -t  tolerance for -c, as the RMS difference in volts (default 1e-3)
+//   -s  write the buffers' summaries to file
+//   -g  check the buffers' summaries against the golden ones in file
+#include <array>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "patch.hpp"
+
+namespace {
+
+constexpr int FRAMES = 1 << 15;
+constexpr int OSCILLATOR_WARMUP_FRAMES = 4096;
+// High enough that the naive waveforms alias audibly.
+constexpr float OSCILLATOR_PITCH = 3.f;
+constexpr float OSCILLATOR_DUTY = 0.3f;
+
+// Spectra are compared over the bins within this range of the peak.
+constexpr double SPECTRUM_RANGE_DB = 60.0;
+// Aliasing may rise this much over the reference, or the golden summary,
+// before -c or -g fails.
+constexpr double ALIAS_TOLERANCE_DB = 1.0;
+// -c compares buffers at the offset, up to this many frames either way, that
+// matches them best, so that a change which only delays the output by a few
+// samples, such as moving where blocks start, isn't a difference.
+constexpr int MAX_LAG = 16;
+
+// Summaries give the power in octave bands centred on 31.25 Hz to 16 kHz.
+constexpr int BANDS = 10;
+constexpr double LOWEST_BAND_HZ = 31.25;
+// -g fails when the RMS level moves by more than this fraction, or a band
+// within BAND_RANGE_DB of the total moves by more than BAND_TOLERANCE_DB,
+// or a waveform's aliasing rises by more than ALIAS_TOLERANCE_DB.
+// Summaries don't depend on phase, so they survive changes to the harness
+// and to rounding that a sample by sample check wouldn't.
+constexpr double RMS_TOLERANCE = 0.02;
+constexpr double BAND_RANGE_DB = 40.0;
+constexpr double BAND_TOLERANCE_DB = 1.0;
+
+// What is patched into Gemini's inputs. KNOBS leaves them all unpatched.
+enum Patch { KNOBS, CV, POLY, PATCHES_LEN };
+constexpr const char* PATCH_NAMES[PATCHES_LEN] = {"", "-cv", "-poly"};
+constexpr int POLY_CHANNELS = 6;
+
+struct Options {
+  bool bandLimited = false;
+  int oversampling = 1;
+  const char* writeDirectory = nullptr;
+  const char* compareDirectory = nullptr;
+  double tolerance = 1e-3;
+  const char* summaryFile = nullptr;
+  const char* goldenFile = nullptr;
+};
+
+struct Buffer {
+  std::string name;
+  std::vector<float> samples;
+  // Zero unless the buffer is a single periodic waveform.
+  double fundamental = 0.0;
+};
+
+enum Waveform { RAMP, PULSE, SUB, WAVEFORMS_LEN };
+constexpr const char* WAVEFORM_NAMES[WAVEFORMS_LEN] = {"ramp", "pulse", "sub"};
+
+void fft(std::vector<std::complex<double>>& x) {
+  const size_t n = x.size();
+  for (size_t i = 1, j = 0; i < n; i++) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      std::swap(x[i], x[j]);
+    }
+  }
+  for (size_t len = 2; len <= n; len <<= 1) {
+    const std::complex<double> step = std::polar(1.0, -2.0 * M_PI / len);
+    for (size_t i = 0; i < n; i += len) {
+      std::complex<double> w = 1.0;
+      for (size_t j = 0; j < len / 2; j++) {
+        const std::complex<double> even = x[i + j];
+        const std::complex<double> odd = x[i + j + len / 2] * w;
+        x[i + j] = even + odd;
+        x[i + j + len / 2] = even - odd;
+        w *= step;
+      }
+    }
+  }
+}
+
+// Blackman windowed power spectrum, in dB, of a power of two length buffer.
+std::vector<double> powerSpectrum(const std::vector<float>& samples) {
+  const size_t n = samples.size();
+  std::vector<std::complex<double>> x(n);
+  for (size_t i = 0; i < n; i++) {
+    const double phase = 2.0 * M_PI * i / (n - 1);
+    const double window =
+        0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+    x[i] = samples[i] * window;
+  }
+  fft(x);
+  std::vector<double> spectrum(n / 2);
+  for (size_t k = 0; k < n / 2; k++) {
+    spectrum[k] = 10.0 * std::log10(std::norm(x[k]) + 1e-30);
+  }
+  return spectrum;
+}
+
+// Power in the audible band away from the harmonics of the fundamental,
+// relative to the power on them.
+double aliasDb(const std::vector<double>& spectrum, double fundamental) {
+  const double binWidth = SAMPLE_RATE / (2.0 * spectrum.size());
+  double harmonicPower = 0.0;
+  double aliasPower = 0.0;
+  for (size_t k = 1; k < spectrum.size(); k++) {
+    const double frequency = k * binWidth;
+    if (frequency < 20.0 || frequency > 20000.0) {
+      continue;
+    }
+    const double harmonic = frequency / fundamental;
+    const double distance =
+        std::fabs(harmonic - std::round(harmonic)) * fundamental;
+    // The Blackman window's main lobe is three bins either side.
+    const double power = std::pow(10.0, spectrum[k] / 10.0);
+    (distance < 4.0 * binWidth ? harmonicPower : aliasPower) += power;
+  }
+  return 10.0 * std::log10(aliasPower / harmonicPower);
+}
+
+// RMS difference, in dB, over the bins either spectrum has within
+// SPECTRUM_RANGE_DB of its peak. Unlike comparing samples, this shrugs off an
+// edge moving by a sample.
+double spectralDistanceDb(const std::vector<double>& a,
+                          const std::vector<double>& b) {
+  double peak = -1e30;
+  for (size_t k = 0; k < a.size(); k++) {
+    peak = std::max(peak, std::max(a[k], b[k]));
+  }
+  double sum = 0.0;
+  int bins = 0;
+  for (size_t k = 0; k < a.size(); k++) {
+    if (std::max(a[k], b[k]) > peak - SPECTRUM_RANGE_DB) {
+      sum += (a[k] - b[k]) * (a[k] - b[k]);
+      bins++;
+    }
+  }
+  return bins ? std::sqrt(sum / bins) : 0.0;
+}
+
+// Sets Gemini's inputs for frame of the patch. CV moves every input at LFO
+// rates: both pitches, which in hard sync puts Pollux's own pitch against the
+// sync, and both duties. POLY plays a chord into Castor's pitch, which Pollux
+// follows.
+void patchInputs(Gemini& gemini, Patch patch, int frame) {
+  const double t = frame / static_cast<double>(SAMPLE_RATE);
+  auto sine = [t](double frequency) {
+    return static_cast<float>(std::sin(2.0 * M_PI * frequency * t));
+  };
+  switch (patch) {
+    case KNOBS:
+      break;
+    case CV:
+      for (Input& input : gemini.inputs) {
+        input.channels = 1;
+      }
+      gemini.inputs[Gemini::CASTOR_PITCH_INPUT].setVoltage(0.1f +
+                                                           0.5f * sine(3.1));
+      gemini.inputs[Gemini::POLLUX_PITCH_INPUT].setVoltage(0.4f +
+                                                           0.3f * sine(4.3));
+      gemini.inputs[Gemini::CASTOR_DUTY_INPUT].setVoltage(2.f * sine(5.7));
+      gemini.inputs[Gemini::POLLUX_DUTY_INPUT].setVoltage(-1.5f * sine(7.3));
+      break;
+    case POLY:
+      gemini.inputs[Gemini::CASTOR_PITCH_INPUT].channels = POLY_CHANNELS;
+      for (int c = 0; c < POLY_CHANNELS; c++) {
+        gemini.inputs[Gemini::CASTOR_PITCH_INPUT].setVoltage(
+            -1.f + c * 7.f / 12.f, c);
+      }
+      break;
+    case PATCHES_LEN:
+      break;
+  }
+}
+
+std::vector<Buffer> renderGemini(const Options& options, Gemini::Mode mode,
+                                 bool alt, bool filter, Patch patch) {
+  Gemini gemini;
+  Module::ProcessArgs args = {SAMPLE_RATE, 1.f / SAMPLE_RATE, 0};
+  patchInputs(gemini, patch, 0);
+  setUpPatch(gemini, args, mode, alt, filter, options.bandLimited,
+             options.oversampling);
+
+  const std::string name = std::string(MODE_NAMES[mode]) +
+                           (alt ? "-alt" : "") + (filter ? "-filter" : "") +
+                           PATCH_NAMES[patch];
+  std::vector<Buffer> buffers = {{name + "-castor"}, {name + "-mix"},
+                                 {name + "-pollux"}};
+  const Gemini::OutputId outputs[] = {Gemini::CASTOR_MIX_OUTPUT,
+                                      Gemini::MIX_OUTPUT,
+                                      Gemini::POLLUX_MIX_OUTPUT};
+  // Skip the frames the outputs lag behind, so renders line up across
+  // changes to the latency. The CV is timed from the first skipped frame, so
+  // each recorded frame is the response to the CV at that frame.
+  int inputFrame = 0;
+  for (int frame = 0; frame < Gemini::LATENCY; frame++) {
+    patchInputs(gemini, patch, inputFrame++);
+    gemini.process(args);
+    args.frame++;
+  }
+  for (int frame = 0; frame < FRAMES; frame++) {
+    patchInputs(gemini, patch, inputFrame++);
+    gemini.process(args);
+    args.frame++;
+    // Polyphonic outputs are summed.
+    for (int i = 0; i < 3; i++) {
+      Output& output = gemini.outputs[outputs[i]];
+      float sum = 0.f;
+      for (int c = 0; c < output.getChannels(); c++) {
+        sum += output.getVoltage(c);
+      }
+      buffers[i].samples.push_back(sum);
+    }
+  }
+  return buffers;
+}
+
+struct Difference {
+  // Frames the buffer lags the reference by.
+  int lag = 0;
+  double max = 0.0;
+  double rms = 0.0;
+};
+
+// The difference from reference at the lag, within MAX_LAG, where it's
+// smallest, over the frames every lag covers.
+Difference difference(const std::vector<float>& samples,
+                      const std::vector<float>& reference) {
+  const int frames = static_cast<int>(reference.size());
+  Difference best;
+  best.rms = INFINITY;
+  for (int lag = -MAX_LAG; lag <= MAX_LAG; lag++) {
+    Difference d{lag};
+    double sumSquares = 0.0;
+    for (int i = MAX_LAG; i < frames - MAX_LAG; i++) {
+      const double diff = samples[i + lag] - reference[i];
+      d.max = std::max(d.max, std::fabs(diff));
+      sumSquares += diff * diff;
+    }
+    d.rms = std::sqrt(sumSquares / (frames - 2 * MAX_LAG));
+    // Ties go to the smallest lag, so identical buffers report 0.
+    if (d.rms < best.rms ||
+        (d.rms == best.rms && std::abs(lag) < std::abs(best.lag))) {
+      best = d;
+    }
+  }
+  return best;
+}
+
+struct Summary {
+  double rms = 0.0;
+  // Power per octave band, in dB relative to the whole spectrum.
+  std::array<double, BANDS> bandsDb{};
+  // aliasDb() for a single waveform, NAN for anything else.
+  double aliasDb = NAN;
+};
+
+Summary summarize(const std::vector<float>& samples,
+                  const std::vector<double>& spectrum, double fundamental) {
+  Summary summary;
+  if (fundamental > 0.0) {
+    summary.aliasDb = aliasDb(spectrum, fundamental);
+  }
+  double sumSquares = 0.0;
+  for (float sample : samples) {
+    sumSquares += static_cast<double>(sample) * sample;
+  }
+  summary.rms = std::sqrt(sumSquares / samples.size());
+
+  const double binWidth = SAMPLE_RATE / (2.0 * spectrum.size());
+  std::array<double, BANDS> bandPower{};
+  double total = 1e-30;
+  for (size_t k = 1; k < spectrum.size(); k++) {
+    const double power = std::pow(10.0, spectrum[k] / 10.0);
+    total += power;
+    const int band = static_cast<int>(
+        std::floor(std::log2(k * binWidth / LOWEST_BAND_HZ) + 0.5));
+    if (band >= 0 && band < BANDS) {
+      bandPower[band] += power;
+    }
+  }
+  for (int band = 0; band < BANDS; band++) {
+    summary.bandsDb[band] =
+        std::max(-120.0, 10.0 * std::log10(bandPower[band] / total + 1e-30));
+  }
+  return summary;
+}
+
+// The largest change in a band that either summary has within BAND_RANGE_DB
+// of its total.
+double bandChangeDb(const Summary& summary, const Summary& golden) {
+  double change = 0.0;
+  for (int band = 0; band < BANDS; band++) {
+    const double a = summary.bandsDb[band];
+    const double b = golden.bandsDb[band];
+    if (std::max(a, b) > -BAND_RANGE_DB) {
+      change = std::max(change, std::fabs(a - b));
+    }
+  }
+  return change;
+}
+
+// A waveform's aliasing fails only by rising. Either summary lacking it, where
+// the other has it, fails too.
+bool aliasRose(const Summary& summary, const Summary& golden) {
+  if (std::isnan(summary.aliasDb) || std::isnan(golden.aliasDb)) {
+    return std::isnan(summary.aliasDb) != std::isnan(golden.aliasDb);
+  }
+  return summary.aliasDb > golden.aliasDb + ALIAS_TOLERANCE_DB;
+}
+
+bool changed(const Summary& summary, const Summary& golden) {
+  return !(std::fabs(summary.rms - golden.rms) <=
+           RMS_TOLERANCE * golden.rms + 1e-4) ||
+         !(bandChangeDb(summary, golden) <= BAND_TOLERANCE_DB) ||
+         aliasRose(summary, golden);
+}
+
+// One line per buffer: its name, RMS level, bands, then for a single waveform
+// its aliasing, after a comment giving the settings they were rendered with.
+bool writeSummaries(const char* path, const std::string& settings,
+                    const std::vector<Buffer>& buffers,
+                    const std::vector<Summary>& summaries) {
+  FILE* file = std::fopen(path, "w");
+  if (!file) {
+    return false;
+  }
+  std::fprintf(file,
+               "# bench/render summaries, %s.\n# Each line is a buffer, its "
+               "RMS in volts, then its power in octave bands\n# from %g Hz, "
+               "in dB relative to its total, and for a single waveform its\n"
+               "# aliasing in dB. Rewrite with `make golden`.\n",
+               settings.c_str(), LOWEST_BAND_HZ);
+  for (size_t i = 0; i < buffers.size(); i++) {
+    std::fprintf(file, "%s %.6f", buffers[i].name.c_str(), summaries[i].rms);
+    for (double band : summaries[i].bandsDb) {
+      std::fprintf(file, " %.2f", band);
+    }
+    if (!std::isnan(summaries[i].aliasDb)) {
+      std::fprintf(file, " %.2f", summaries[i].aliasDb);
+    }
+    std::fprintf(file, "\n");
+  }
+  return std::fclose(file) == 0;
+}
+
+bool readSummaries(const char* path, std::map<std::string, Summary>* golden) {
+  FILE* file = std::fopen(path, "r");
+  if (!file) {
+    return false;
+  }
+  char line[1024];
+  while (std::fgets(line, sizeof(line), file)) {
+    if (line[0] == '#') {
+      continue;
+    }
+    char name[256];
+    Summary summary;
+    int offset = 0;
+    if (std::sscanf(line, "%255s %lf%n", name, &summary.rms, &offset) != 2) {
+      continue;
+    }
+    const char* rest = line + offset;
+    for (double& band : summary.bandsDb) {
+      int read = 0;
+      std::sscanf(rest, "%lf%n", &band, &read);
+      rest += read;
+    }
+    // Absent for anything but a single waveform.
+    std::sscanf(rest, "%lf", &summary.aliasDb);
+    (*golden)[name] = summary;
+  }
+  std::fclose(file);
+  return true;
+}
+
+template <bool FILTER, bool BAND_LIMITED>
+Buffer renderOscillator(Waveform waveform) {
+  OscillatorState<simd::float_4> oscillator;
+  oscillator.updateSampleRate(SAMPLE_RATE);
+  oscillator.enableFilter(FILTER);
+  oscillator.updatePitch(OSCILLATOR_PITCH);
+
+  Buffer buffer = {std::string("oscillator-") + WAVEFORM_NAMES[waveform] +
+                   (FILTER ? "-filter" : "")};
+  // Frames of the first and last phase wraps give the period to within a
+  // sample across the whole buffer.
+  int firstWrap = -1;
+  int lastWrap = -1;
+  int cycles = 0;
+  for (int frame = 0; frame < OSCILLATOR_WARMUP_FRAMES + FRAMES; frame++) {
+    const bool reset = simd::movemask(oscillator.updatePhase()) & 1;
+    const Signals<simd::float_4> signals =
+        oscillator.template getSignals<FILTER, BAND_LIMITED>(OSCILLATOR_DUTY,
+                                                             0.f);
+    if (frame < OSCILLATOR_WARMUP_FRAMES) {
+      continue;
+    }
+    if (reset) {
+      firstWrap = firstWrap < 0 ? frame : firstWrap;
+      lastWrap = frame;
+      cycles++;
+    }
+    const simd::float_4 signal = waveform == RAMP    ? signals.ramp
+                                 : waveform == PULSE ? signals.pulse
+                                                     : signals.sub;
+    buffer.samples.push_back(signal[0]);
+  }
+  // The sub oscillator runs an octave down.
+  buffer.fundamental = (cycles - 1) * SAMPLE_RATE / (lastWrap - firstWrap) /
+                       (waveform == SUB ? 2.0 : 1.0);
+  return buffer;
+}
+
+template <bool BAND_LIMITED>
+void renderOscillators(std::vector<Buffer>& buffers) {
+  for (int waveform = 0; waveform < WAVEFORMS_LEN; waveform++) {
+    buffers.push_back(
+        renderOscillator<false, BAND_LIMITED>(static_cast<Waveform>(waveform)));
+    buffers.push_back(
+        renderOscillator<true, BAND_LIMITED>(static_cast<Waveform>(waveform)));
+  }
+}
+
+std::string pathFor(const char* directory, const Buffer& buffer) {
+  return std::string(directory) + "/" + buffer.name + ".f32";
+}
+
+bool write(const char* directory, const Buffer& buffer) {
+  FILE* file = std::fopen(pathFor(directory, buffer).c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+  const size_t written = std::fwrite(buffer.samples.data(), sizeof(float),
+                                     buffer.samples.size(), file);
+  return std::fclose(file) == 0 && written == buffer.samples.size();
+}
+
+bool read(const char* directory, const Buffer& buffer,
+          std::vector<float>* samples) {
+  FILE* file = std::fopen(pathFor(directory, buffer).c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  samples->resize(buffer.samples.size());
+  const size_t read =
+      std::fread(samples->data(), sizeof(float), samples->size(), file);
+  std::fclose(file);
+  return read == samples->size();
+}
+
+bool parseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    if (!std::strcmp(argv[i], "-b")) {
+      options->bandLimited = true;
+    } else if (!std::strcmp(argv[i], "-o") && i + 1 < argc) {
+      options->oversampling = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "-w") && i + 1 < argc) {
+      options->writeDirectory = argv[++i];
+    } else if (!std::strcmp(argv[i], "-c") && i + 1 < argc) {
+      options->compareDirectory = argv[++i];
+    } else if (!std::strcmp(argv[i], "-t") && i + 1 < argc) {
+      options->tolerance = std::atof(argv[++i]);
+    } else if (!std::strcmp(argv[i], "-s") && i + 1 < argc) {
+      options->summaryFile = argv[++i];
+    } else if (!std::strcmp(argv[i], "-g") && i + 1 < argc) {
+      options->goldenFile = argv[++i];
+    } else {
+      return false;
+    }
+  }
+  const int oversampling = options->oversampling;
+  return !(options->writeDirectory && options->compareDirectory) &&
+         !(options->summaryFile && options->goldenFile) && oversampling > 0 &&
+         oversampling <= Gemini::MAX_OVERSAMPLING &&
+         (oversampling & (oversampling - 1)) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, &options)) {
+    std::fprintf(stderr,
+                 "usage: %s [-b] [-o 1|2|4|8] [-w dir | -c dir] "
+                 "[-t tolerance] [-s file | -g file]\n",
+                 argv[0]);
+    return 1;
+  }
+  flushDenormals();
+
+  std::vector<Buffer> buffers;
+  for (int mode = 0; mode < Gemini::MODES_LEN; mode++) {
+    for (bool alt : {false, true}) {
+      for (bool filter : {false, true}) {
+        for (Buffer& buffer :
+             renderGemini(options, static_cast<Gemini::Mode>(mode), alt,
+                          filter, KNOBS)) {
+          buffers.push_back(std::move(buffer));
+        }
+      }
+    }
+  }
+  for (int mode = 0; mode < Gemini::MODES_LEN; mode++) {
+    for (Patch patch : {CV, POLY}) {
+      for (Buffer& buffer :
+           renderGemini(options, static_cast<Gemini::Mode>(mode), false,
+                        true, patch)) {
+        buffers.push_back(std::move(buffer));
+      }
+    }
+  }
+  if (options.bandLimited) {
+    renderOscillators<true>(buffers);
+  } else {
+    renderOscillators<false>(buffers);
+  }
+
+  char settings[64];
+  std::snprintf(settings, sizeof(settings),
+                "band-limited %s, %dx oversampling",
+                options.bandLimited ? "on" : "off", options.oversampling);
+  std::printf("%d frames at %.0f Hz, %s\n\n", FRAMES, SAMPLE_RATE, settings);
+
+  std::map<std::string, Summary> golden;
+  if (options.goldenFile && !readSummaries(options.goldenFile, &golden)) {
+    std::fprintf(stderr, "can't read %s\n", options.goldenFile);
+    return 1;
+  }
+
+  std::printf("%-32s %9s", "buffer", "alias dB");
+  if (options.compareDirectory) {
+    std::printf(" %9s %4s %10s %10s %11s", "was dB", "lag", "max diff",
+                "rms diff", "spectrum dB");
+  }
+  if (options.goldenFile) {
+    std::printf(" %9s %9s %8s %9s", "rms", "was rms", "band dB", "was alias");
+  }
+  std::printf("\n");
+
+  int failures = 0;
+  std::vector<Summary> summaries;
+  for (const Buffer& buffer : buffers) {
+    const std::vector<double> spectrum = powerSpectrum(buffer.samples);
+    summaries.push_back(
+        summarize(buffer.samples, spectrum, buffer.fundamental));
+    std::printf("%-32s", buffer.name.c_str());
+    if (buffer.fundamental > 0.0) {
+      std::printf(" %9.1f", summaries.back().aliasDb);
+    } else {
+      std::printf(" %9s", "-");
+    }
+
+    if (options.writeDirectory && !write(options.writeDirectory, buffer)) {
+      std::printf(" write failed");
+      failures++;
+    }
+
+    std::vector<float> reference;
+    if (!options.compareDirectory) {
+      // Nothing to compare against.
+    } else if (!read(options.compareDirectory, buffer, &reference)) {
+      std::printf(" %9s missing", "-");
+      failures++;
+    } else {
+      const std::vector<double> referenceSpectrum = powerSpectrum(reference);
+      const Difference diff = difference(buffer.samples, reference);
+      bool failed = !(diff.rms <= options.tolerance);
+      if (buffer.fundamental > 0.0) {
+        const double alias = summaries.back().aliasDb;
+        const double referenceAlias =
+            aliasDb(referenceSpectrum, buffer.fundamental);
+        failed |= alias > referenceAlias + ALIAS_TOLERANCE_DB;
+        std::printf(" %9.1f", referenceAlias);
+      } else {
+        std::printf(" %9s", "-");
+      }
+      std::printf(" %4d %10.6f %10.6f %11.2f%s", diff.lag, diff.max,
+                  diff.rms, spectralDistanceDb(spectrum, referenceSpectrum),
+                  failed ? "  FAIL" : "");
+      failures += failed;
+    }
+
+    if (options.goldenFile) {
+      const Summary& summary = summaries.back();
+      const auto found = golden.find(buffer.name);
+      if (found == golden.end()) {
+        std::printf(" %9.4f %9s missing", summary.rms, "-");
+        failures++;
+      } else {
+        const bool failed = changed(summary, found->second);
+        std::printf(" %9.4f %9.4f %8.2f", summary.rms, found->second.rms,
+                    bandChangeDb(summary, found->second));
+        if (std::isnan(found->second.aliasDb)) {
+          std::printf(" %9s", "-");
+        } else {
+          std::printf(" %9.1f", found->second.aliasDb);
+        }
+        std::printf("%s", failed ? "  FAIL" : "");
+        failures += failed;
+        golden.erase(found);
+      }
+    }
+    std::printf("\n");
+  }
+  // Buffers that are no longer rendered fail too, until the golden file is
+  // rewritten.
+  for (const auto& [name, summary] : golden) {
+    std::printf("%-32s not rendered  FAIL\n", name.c_str());
+    failures++;
+  }
+
+  if (options.summaryFile &&
+      !writeSummaries(options.summaryFile, settings, buffers, summaries)) {
+    std::fprintf(stderr, "can't write %s\n", options.summaryFile);
+    return 1;
+  }
+
+  if (failures) {
+    std::printf("\n%d of %zu buffers failed\n", failures, buffers.size());
+  }
+  return failures ? 1 : 0;
+}
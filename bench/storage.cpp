@@ -0,0 +1,168 @@
+// Checks that Gemini's patch storage round-trips: random param banks and
+// settings are saved and loaded into a fresh instance, in the current format
+// and in the per-key format of patches from before versioning, and must come
+// back exactly. Then times saving and loading a patch of many instances.
+//
+// The JSON here is the stand-in in rack.hpp rather than jansson, so the times
+// are for Gemini's side of the work and only roughly Rack's.
+//
+// usage: storage [-n instances] [-s seed]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "patch.hpp"
+
+namespace {
+
+constexpr int ROUND_TRIPS = 1000;
+
+struct Options {
+  int instances = 1000;
+  unsigned seed = 1;
+};
+
+// Fills the bank with values in range for each slot's param, and picks random
+// settings.
+void randomise(Gemini& gemini, std::mt19937& random) {
+  for (int slot = 0; slot < Gemini::SLOTS_LEN; slot++) {
+    const ParamQuantity* quantity =
+        gemini.getParamQuantity(Gemini::SLOT_PARAMS[slot]);
+    float value = std::uniform_real_distribution<float>(
+        quantity->minValue, quantity->maxValue)(random);
+    if (quantity->snapEnabled) {
+      value = std::round(value);
+    }
+    gemini.paramBank[slot] = value;
+  }
+  gemini.bandLimited = random() & 1;
+  gemini.oversampling = 1 << (random() % 4);
+  gemini.unison = 1 + random() % Gemini::MAX_UNISON;
+  gemini.unisonDetune =
+      Gemini::UNISON_DETUNES[random() % Gemini::UNISON_DETUNES.size()];
+}
+
+// Saves gemini the way patches did before versioning.
+json_t* legacyDataToJson(Gemini& gemini) {
+  json_t* rootJ = json_object();
+  char name[32];
+  for (int altMode = 0; altMode < 2; ++altMode) {
+    for (int mode = 0; mode < Gemini::MODES_LEN; ++mode) {
+      for (int param = 0; param < Gemini::PARAMS_LEN; ++param) {
+        std::snprintf(name, sizeof(name), "%d/%d/%d", param, mode, altMode);
+        json_object_set_new(
+            rootJ, name,
+            json_real(gemini.paramBank
+                          [Gemini::PARAM_SLOTS[altMode][mode][param]]));
+      }
+    }
+  }
+  json_object_set_new(rootJ, "bandLimited", json_boolean(gemini.bandLimited));
+  json_object_set_new(rootJ, "oversampling",
+                      json_integer(gemini.oversampling));
+  return rootJ;
+}
+
+bool sameState(const Gemini& a, const Gemini& b) {
+  return a.paramBank == b.paramBank && a.bandLimited == b.bandLimited &&
+         a.oversampling == b.oversampling && a.unison == b.unison &&
+         a.unisonDetune == b.unisonDetune;
+}
+
+// Returns false on the first patch that doesn't load back as it was saved.
+template <typename Save>
+bool checkRoundTrips(const char* format, Save save, unsigned seed,
+                     bool hasUnison) {
+  std::mt19937 random(seed);
+  for (int trip = 0; trip < ROUND_TRIPS; trip++) {
+    Gemini saved;
+    randomise(saved, random);
+    if (!hasUnison) {
+      saved.unison = Gemini().unison.load();
+      saved.unisonDetune = Gemini().unisonDetune.load();
+    }
+    json_t* rootJ = save(saved);
+    Gemini loaded;
+    loaded.dataFromJson(rootJ);
+    json_decref(rootJ);
+    if (!sameState(saved, loaded)) {
+      std::printf("%s: round trip %d loaded a different patch\n", format,
+                  trip);
+      return false;
+    }
+  }
+  std::printf("%s: %d round trips exact\n", format, ROUND_TRIPS);
+  return true;
+}
+
+// Microseconds per instance to save, then to load, a patch of instances.
+template <typename Save>
+void timeStorage(const char* format, Save save,
+                 std::vector<std::unique_ptr<Gemini>>& instances) {
+  std::vector<json_t*> patch(instances.size());
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < instances.size(); i++) {
+    patch[i] = save(*instances[i]);
+  }
+  const auto saved = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < instances.size(); i++) {
+    instances[i]->dataFromJson(patch[i]);
+  }
+  const auto loaded = std::chrono::steady_clock::now();
+  for (json_t* rootJ : patch) {
+    json_decref(rootJ);
+  }
+
+  const std::chrono::duration<double, std::micro> saving = saved - start;
+  const std::chrono::duration<double, std::micro> loading = loaded - saved;
+  std::printf("%-8s %10.2f %10.2f\n", format,
+              saving.count() / instances.size(),
+              loading.count() / instances.size());
+}
+
+json_t* dataToJson(Gemini& gemini) { return gemini.dataToJson(); }
+
+bool parseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+      options->instances = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "-s") && i + 1 < argc) {
+      options->seed = std::strtoul(argv[++i], nullptr, 10);
+    } else {
+      return false;
+    }
+  }
+  return options->instances > 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, &options)) {
+    std::fprintf(stderr, "usage: %s [-n instances] [-s seed]\n", argv[0]);
+    return 1;
+  }
+
+  // Patches from before versioning predate unison, so load with none.
+  if (!checkRoundTrips("current", dataToJson, options.seed, true) ||
+      !checkRoundTrips("legacy", legacyDataToJson, options.seed, false)) {
+    return 1;
+  }
+
+  std::mt19937 random(options.seed);
+  std::vector<std::unique_ptr<Gemini>> instances;
+  for (int i = 0; i < options.instances; i++) {
+    instances.push_back(std::make_unique<Gemini>());
+    randomise(*instances.back(), random);
+  }
+  std::printf("\n%d instances\n%-8s %10s %10s\n", options.instances, "format",
+              "save us", "load us");
+  timeStorage("current", dataToJson, instances);
+  timeStorage("legacy", legacyDataToJson, instances);
+  return 0;
+}
@@ -0,0 +1,159 @@
+// Drives Gemini with hostile input and checks every output sample is finite.
+// Each block of frames picks a random mode, alt mode, filter setting,
+// band-limiting, oversampling, unison and sample rate, random knob positions,
+// and CV that is sometimes ordinary and sometimes huge, infinite, denormal or
+// NaN.
+//
+// usage: stress [-n blocks] [-s seed]
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <random>
+
+#include "patch.hpp"
+
+namespace {
+
+constexpr float SAMPLE_RATES[] = {8000.f,  11025.f, 44100.f,  48000.f,
+                                  96000.f, 192000.f, 768000.f};
+constexpr int MAX_BLOCK_FRAMES = 4096;
+
+struct Options {
+  int blocks = 2000;
+  unsigned seed = 1;
+};
+
+class Stress {
+ public:
+  explicit Stress(unsigned seed) : random(seed) {
+    for (Output& output : gemini.outputs) {
+      output.channels = 1;
+    }
+  }
+
+  // Returns false on the first non-finite output.
+  bool runBlock(int block) {
+    if (chance(0.1f)) {
+      const float sampleRate =
+          SAMPLE_RATES[uniformInt(0, std::size(SAMPLE_RATES) - 1)];
+      args.sampleRate = sampleRate;
+      args.sampleTime = 1.f / sampleRate;
+      gemini.onSampleRateChange({sampleRate, 1.f / sampleRate});
+    }
+    if (chance(0.05f)) {
+      json_t* rootJ = gemini.dataToJson();
+      gemini.dataFromJson(rootJ);
+      json_decref(rootJ);
+    }
+    gemini.bandLimited = chance(0.5f);
+    gemini.oversampling = 1 << uniformInt(0, 3);
+    gemini.unison = chance(0.5f) ? 1 : uniformInt(2, Gemini::MAX_UNISON);
+    for (int p = 0; p < Gemini::PARAMS_LEN; p++) {
+      const ParamQuantity* quantity = gemini.getParamQuantity(p);
+      float value = uniform(quantity->minValue, quantity->maxValue);
+      if (quantity->snapEnabled) {
+        value = std::round(value);
+      }
+      gemini.params[p].setValue(value);
+    }
+    for (Input& input : gemini.inputs) {
+      input.channels = uniformInt(0, Gemini::MAX_CHANNELS);
+      for (int c = 0; c < Gemini::MAX_CHANNELS; c++) {
+        input.voltages[c] = c < input.channels ? voltage() : 0.f;
+      }
+    }
+
+    const int frames = uniformInt(1, MAX_BLOCK_FRAMES);
+    for (int frame = 0; frame < frames; frame++) {
+      gemini.process(args);
+      args.frame++;
+      for (int o = 0; o < Gemini::OUTPUTS_LEN; o++) {
+        const Output& output = gemini.outputs[o];
+        for (int c = 0; c < output.channels; c++) {
+          if (!std::isfinite(output.voltages[c])) {
+            std::printf(
+                "block %d frame %d: output %d channel %d is %f (%s%s, "
+                "filter %s, band-limited %s, %dx, unison %d, %.0f Hz)\n",
+                block, frame, o, c, output.voltages[c],
+                MODE_NAMES[gemini.getMode()], gemini.altMode ? " alt" : "",
+                gemini.params[Gemini::FILTER_ENABLE_BUTTON_PARAM].getValue()
+                    ? "on"
+                    : "off",
+                gemini.bandLimited ? "on" : "off", gemini.activeOversampling,
+                gemini.activeUnison, args.sampleRate);
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+ private:
+  std::mt19937 random;
+  Gemini gemini;
+  Module::ProcessArgs args = {SAMPLE_RATE, 1.f / SAMPLE_RATE, 0};
+
+  bool chance(float probability) { return uniform(0.f, 1.f) < probability; }
+
+  float uniform(float min, float max) {
+    return std::uniform_real_distribution<float>(min, max)(random);
+  }
+
+  int uniformInt(int min, int max) {
+    return std::uniform_int_distribution<int>(min, max)(random);
+  }
+
+  float voltage() {
+    switch (uniformInt(0, 7)) {
+      case 0:
+        return std::numeric_limits<float>::quiet_NaN();
+      case 1:
+        return std::numeric_limits<float>::infinity();
+      case 2:
+        return -std::numeric_limits<float>::infinity();
+      case 3:
+        return uniform(-1e30f, 1e30f);
+      case 4:
+        return std::numeric_limits<float>::denorm_min();
+      default:
+        return uniform(-10.f, 10.f);
+    }
+  }
+};
+
+bool parseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; i++) {
+    if (!std::strcmp(argv[i], "-n") && i + 1 < argc) {
+      options->blocks = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "-s") && i + 1 < argc) {
+      options->seed = std::strtoul(argv[++i], nullptr, 10);
+    } else {
+      return false;
+    }
+  }
+  return options->blocks > 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, &options)) {
+    std::fprintf(stderr, "usage: %s [-n blocks] [-s seed]\n", argv[0]);
+    return 1;
+  }
+  flushDenormals();
+
+  Stress stress(options.seed);
+  for (int block = 0; block < options.blocks; block++) {
+    if (!stress.runBlock(block)) {
+      return 1;
+    }
+  }
+  std::printf("%d blocks, seed %u: all outputs finite\n", options.blocks,
+              options.seed);
+  return 0;
+}
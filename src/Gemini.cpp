@@ -1,827 +1,70 @@
-#include <algorithm>
-#include <array>
-#include <cassert>
-#include <cmath>
-#include <map>
-#include <vector>
-
-#include "engine/ParamQuantity.hpp"
-#include "plugin.hpp"
-
-// TOOD - maybe this could be one of those fancy simd things?
-struct Signals {
-  float ramp;
-  float pulse;
-  float sub;
-};
-
-const static int SAMPLE_COUNT = 96000;
-
-struct ReplaceableLabelParamQuantity : ParamQuantity {
-  std::string getLabel() override { return this->contents; }
-
-  void setLabel(std::string s) { this->contents = s; }
-
- private:
-  std::string contents;
-};
-
-using DecayTable = std::array<float, SAMPLE_COUNT>;
-
-inline constexpr float rampCapacitorDecayFn(
-    const float phase) {                    // phase \in [-1, 1]
-  const float exponent = phase - 1.f;       // exponent in [0, -2]
-  const float decay = std::exp2(exponent);  // decay \in [1, 0.25];
-  const float offset = decay - 0.25f;       // offset \in [0.75, 0]
-  const float stretchFactor = 2.f / 0.75f;
-  const float stretch = offset * stretchFactor;  // stretch \in [2, 0]
-  return stretch - 1.f;
-}
-
-const DecayTable calculateRampDecayTable() {
-  DecayTable table{};
-  for (int32_t i = 0; i < SAMPLE_COUNT; i++) {
-    table[i] = rampCapacitorDecayFn((48000.0f - (float)i) / 48000.f);
-  }
-  return table;
-}
-
-static const DecayTable rampCapacitorDecay = calculateRampDecayTable();
-
-int32_t indexFromPhase(float phase) {
-  const int32_t phaseI =
-      std::floor(phase * 48000.f);       // phaseI in [-48000, 48000]
-  const int32_t index = 48000 + phaseI;  // index in [0,96000]
-  return index;
-}
-
-float rampWavetableValue(float phase) {  // phase in [-1, 1]
-  return rampCapacitorDecay[indexFromPhase(phase)];
-}
-
-class OscillatorState {
-  float phase = -1.f;  // in [-1, 1]
-  float pitch = 0.f;   // Unbounded, usually between [-10, 10]
-  const float baseFrequency;
-  float frequency;     // baseFrequency * 2 ^ pitch;
-  bool cycle = false;  // Used to determine the current cycle for the sub-pulse.
-  bool filterEnabled = true;
-
-  dsp::TBiquadFilter<float> lowPassRamp;
-  dsp::TBiquadFilter<float> lowPassPulse;
-  dsp::TBiquadFilter<float> lowPassSub;
-  dsp::TBiquadFilter<float> highPassRamp;
-  dsp::TBiquadFilter<float> highPassPulse;
-  dsp::TBiquadFilter<float> highPassSub;
-
-  dsp::TBiquadFilter<float> lowPassMix;
-
-  std::vector<dsp::TBiquadFilter<float>*> allFilters{
-      &lowPassRamp,   &lowPassPulse, &lowPassSub, &highPassRamp,
-      &highPassPulse, &highPassSub,  &lowPassMix,
-  };
-
-  static constexpr float FILTER_Q = 0.7f;
-  static constexpr float FILTER_V = 1.f;
-
- public:
-  OscillatorState(float startingFrequency)
-      : baseFrequency(startingFrequency), frequency(startingFrequency) {
-    updateSampleRate(48000.f);
-  }
-
-  void updateSampleRate(float sampleRate) {
-    float halfIsh = (sampleRate - 0.01f) / 2.f;
-    lowPassRamp.setParameters(dsp::TBiquadFilter<float>::Type::LOWPASS_1POLE,
-                              halfIsh, FILTER_Q, FILTER_V);
-    lowPassPulse.setParameters(dsp::TBiquadFilter<float>::Type::LOWPASS_1POLE,
-                               halfIsh, FILTER_Q, FILTER_V);
-    lowPassSub.setParameters(dsp::TBiquadFilter<float>::Type::LOWPASS_1POLE,
-                             halfIsh, FILTER_Q, FILTER_V);
-    highPassRamp.setParameters(dsp::TBiquadFilter<float>::Type::HIGHPASS_1POLE,
-                               FILTER_Q / sampleRate, 0.3f, FILTER_V);
-    highPassPulse.setParameters(dsp::TBiquadFilter<float>::Type::HIGHPASS_1POLE,
-                                FILTER_Q / sampleRate, 0.3f, FILTER_V);
-    highPassSub.setParameters(dsp::TBiquadFilter<float>::Type::HIGHPASS_1POLE,
-                              FILTER_Q / sampleRate, 0.3f, FILTER_V);
-
-    lowPassMix.setParameters(dsp::TBiquadFilter<float>::Type::HIGHPASS_1POLE,
-                             halfIsh, FILTER_Q, FILTER_V);
-  }
-
-  void resetFilters() {
-    for (auto* filter : allFilters) {
-      filter->reset();
-    }
-  }
-  // For hard sync
-  void resetPhase() {
-    phase = -1.f;
-    cycle = false;
-  }
-
-  // Returns true if reset occurs.
-  bool updatePhase(float sampleTime) {
-    phase += frequency * sampleTime;
-    if (phase >= 1.f) {
-      phase -= 2.f;
-      this->cycle = !this->cycle;
-      return true;
-    }
-    return false;
-  }
-
-  void updatePitch(float pitch) {
-    if (this->pitch == pitch) {
-      return;
-    }
-    this->pitch = pitch;
-    this->frequency = baseFrequency * std::pow(2.f, pitch);
-  }
-
-  void enableFilter(bool filterEnabled) {
-    if (filterEnabled != this->filterEnabled) {
-      this->filterEnabled = filterEnabled;
-      this->resetFilters();
-    }
-  }
-
-  float triangle() {  // phase \in [-1, 1)
-    float triangle = this->phase + 1.f;
-    if (triangle > 1.f) {
-      triangle = 1.f - (triangle - 1.f);  // triangle \in [0, 1)
-    }
-    triangle *= 2.f;        // triangle \in [0, 2)
-    return triangle - 1.f;  // result in [-1, 1)
-  }
-
-  float ramp() {  // phase \in [-1, 1)
-    if (this->filterEnabled) {
-      return rampWavetableValue(this->phase);
-    } else {
-      return -this->phase;
-    }
-  }
-
-  // Shift the phase to make it match gemini.wntr.dev diagrams.
-  float sub() {  // phase \in [-1, 1)
-    if (this->filterEnabled) {
-      // Apply a slight linear decrease, proportional to the phase.
-      float offset = 1.f - ((1.f + phase) / 10.f);
-      return cycle ? -offset : offset;
-    } else {
-      return cycle ? -1.f : 1.f;
-    }
-  }
-
-  // phase \in [-1, 1), duty in [0, 1), offset \in [0, 1]
-  float pulse(float duty, float offset = 0.f) {
-    float normal = (phase + 1.f) / 2.f;
-    return normal > duty ? -1.f : 1.f;
-  }
-
-  float process(dsp::TBiquadFilter<float>* filter, float value) {
-    if (!this->filterEnabled) {
-      return value;
-    }
-
-    float firstPass = filter->process(value);
-    if (std::isnan(firstPass)) {
-      filter->reset();
-      float secondPass = filter->process(value);
-      return std::isnan(secondPass) ? value : secondPass;
-    } else {
-      return firstPass;
-    }
-  }
-
-  Signals getSignals(float duty, float offset) {
-    return {
-        process(&highPassRamp, process(&lowPassRamp, ramp())),
-        process(&highPassPulse, process(&lowPassPulse, pulse(duty, offset))),
-        process(&highPassSub, process(&lowPassSub, sub())),
-    };
-  }
-
-  float getOutput(const Signals& wave, const Signals& amplitude) {
-    return process(&lowPassMix, 5.f *
-                                    (wave.ramp * amplitude.ramp +
-                                     wave.pulse * amplitude.pulse +
-                                     wave.sub * amplitude.sub) /
-                                    3.f);
-  }
-};
-
-struct Gemini : Module {
-  enum ParamId {
-    CASTOR_PITCH_PARAM,
-    POLLUX_PITCH_PARAM,
-    LFO_PARAM,
-    CASTOR_DUTY_PARAM,
-    POLLUX_DUTY_PARAM,
-    CROSSFADE_PARAM,
-    CASTOR_RAMP_LEVEL_PARAM,
-    CASTOR_PULSE_LEVEL_PARAM,
-    POLLUX_PULSE_LEVEL_PARAM,
-    BUTTON_PARAM,
-    CASTOR_SUB_LEVEL_PARAM,
-    POLLUX_SUB_LEVEL_PARAM,
-    POLLUX_RAMP_LEVEL_PARAM,
-    ALT_MODE_BUTTON_PARAM,
-    FILTER_ENABLE_BUTTON_PARAM,
-    PARAMS_LEN
-  };
-  enum InputId {
-    CASTOR_DUTY_INPUT,
-    POLLUX_DUTY_INPUT,
-    CASTOR_PITCH_INPUT,
-    POLLUX_PITCH_INPUT,
-    INPUTS_LEN
-  };
-  enum OutputId {
-    CASTOR_MIX_OUTPUT,
-    MIX_OUTPUT,
-    POLLUX_MIX_OUTPUT,
-    OUTPUTS_LEN
-  };
-  enum LightId { LIGHTS_LEN };
-
-  enum Mode {
-    CHORUS,
-    LFO_PWM,
-    LFO_FM,
-    HARD_SYNC,
-  };
-
-  // Param Values - updated by user, can be slightly stale.
-  float castorPitchParam, castorDutyParam, castorRampLevelParam,
-      castorPulseLevelParam, castorSubParam;
-  float polluxPitchParam, polluxDutyParam, polluxRampLevelParam,
-      polluxPulseLevelParam, polluxSubParam;
-  float lfoParam;
-  float buttonParam;
-  float altModeParam;
-  float crossfadeParam;
-
-  Mode mode = CHORUS;
-  bool altMode = false;
-
-  float altModeLfoCv = 0.f;
-  float lfoAmplitudeValue = 0.f;
-  float lfoChorusFreqCv = 0.f;
-  float lfoPwmFreqCv = 0.f;
-  float lfoFmFreqCv = 0.f;
-  float lfoHardSyncFreqCv = 0.f;
-  float lfoPwmCastorPulseWidthCentre = 0.f;
-  float lfoPwmPolluxPulseWidthCentre = 0.f;
-  float lfoFmCastorPulseWidth = 0.5f;
-  float lfoFmPolluxPulseWidth = 0.5f;
-  float polluxPitchMultiplier = -1.f;
-  float enableFilter = 1.f;
-
-  float paramsLen = -3.14f;
-
-  // State
-  OscillatorState castor = OscillatorState(rack::dsp::FREQ_C4);
-  OscillatorState pollux = OscillatorState(rack::dsp::FREQ_C4);
-  OscillatorState lfo = OscillatorState(2.f);
-
-  std::map<ParamId, ReplaceableLabelParamQuantity*> paramIdToParam;
-
-  ReplaceableLabelParamQuantity* castor_pitch_param;
-  ReplaceableLabelParamQuantity* pollux_pitch_param;
-  ReplaceableLabelParamQuantity* lfo_param;
-  ReplaceableLabelParamQuantity* castor_duty_param;
-  ReplaceableLabelParamQuantity* pollux_duty_param;
-  ReplaceableLabelParamQuantity* crossfade_param;
-  ReplaceableLabelParamQuantity* castor_ramp_level_param;
-  ReplaceableLabelParamQuantity* castor_pulse_level_param;
-  ReplaceableLabelParamQuantity* pollux_pulse_level_param;
-  ReplaceableLabelParamQuantity* button_param;
-  ReplaceableLabelParamQuantity* castor_sub_level_param;
-  ReplaceableLabelParamQuantity* pollux_sub_level_param;
-  ReplaceableLabelParamQuantity* pollux_ramp_level_param;
-  ReplaceableLabelParamQuantity* alt_mode_button_param;
-  ReplaceableLabelParamQuantity* filter_enable_button_param;
-
-  Gemini() {
-    config(PARAMS_LEN, INPUTS_LEN, OUTPUTS_LEN, LIGHTS_LEN);
-
-    castor_pitch_param = configParam<ReplaceableLabelParamQuantity>(
-        CASTOR_PITCH_PARAM, -1.f, 1.f, 0.f, "Castor pitch");
-    paramIdToParam[CASTOR_PITCH_PARAM] = castor_pitch_param;
-    pollux_pitch_param = configParam<ReplaceableLabelParamQuantity>(
-        POLLUX_PITCH_PARAM, -1.f, 1.f, 0.f, "Pollux pitch");
-    paramIdToParam[POLLUX_PITCH_PARAM] = pollux_pitch_param;
-    lfo_param = configParam<ReplaceableLabelParamQuantity>(LFO_PARAM, 0.f, 1.f,
-                                                           0.f, "LFO");
-    paramIdToParam[LFO_PARAM] = lfo_param;
-    castor_duty_param = configParam<ReplaceableLabelParamQuantity>(
-        CASTOR_DUTY_PARAM, 0.f, 1.f, 0.f, "Castor duty");
-    paramIdToParam[CASTOR_DUTY_PARAM] = castor_duty_param;
-    pollux_duty_param = configParam<ReplaceableLabelParamQuantity>(
-        POLLUX_DUTY_PARAM, 0.f, 1.f, 0.f, "Pollux duty");
-    paramIdToParam[POLLUX_DUTY_PARAM] = pollux_duty_param;
-    crossfade_param = configParam<ReplaceableLabelParamQuantity>(
-        CROSSFADE_PARAM, 0.f, 1.f, 0.5f, "Crossfade");
-    paramIdToParam[CROSSFADE_PARAM] = crossfade_param;
-    castor_ramp_level_param = configParam<ReplaceableLabelParamQuantity>(
-        CASTOR_RAMP_LEVEL_PARAM, 0.f, 1.f, 0.f, "Castor ramp level");
-    paramIdToParam[CASTOR_RAMP_LEVEL_PARAM] = castor_ramp_level_param;
-    castor_pulse_level_param = configParam<ReplaceableLabelParamQuantity>(
-        CASTOR_PULSE_LEVEL_PARAM, 0.f, 1.f, 0.f, "Castor pulse level");
-    paramIdToParam[CASTOR_PULSE_LEVEL_PARAM] = castor_pulse_level_param;
-    pollux_pulse_level_param = configParam<ReplaceableLabelParamQuantity>(
-        POLLUX_PULSE_LEVEL_PARAM, 0.f, 1.f, 0.f, "Pollux pulse level");
-    paramIdToParam[POLLUX_PULSE_LEVEL_PARAM] = pollux_pulse_level_param;
-    button_param = configParam<ReplaceableLabelParamQuantity>(
-        BUTTON_PARAM, 0.f, 3.f, 0.f, "Mode switch");
-    paramIdToParam[BUTTON_PARAM] = button_param;
-    castor_sub_level_param = configParam<ReplaceableLabelParamQuantity>(
-        CASTOR_SUB_LEVEL_PARAM, 0.f, 1.f, 0.f, "Castor sub level");
-    paramIdToParam[CASTOR_SUB_LEVEL_PARAM] = castor_sub_level_param;
-    pollux_sub_level_param = configParam<ReplaceableLabelParamQuantity>(
-        POLLUX_SUB_LEVEL_PARAM, 0.f, 1.f, 0.f, "Pollux sub level");
-    paramIdToParam[POLLUX_SUB_LEVEL_PARAM] = pollux_sub_level_param;
-    pollux_ramp_level_param = configParam<ReplaceableLabelParamQuantity>(
-        POLLUX_RAMP_LEVEL_PARAM, 0.f, 1.f, 0.f, "Pollux ramp level");
-    paramIdToParam[POLLUX_RAMP_LEVEL_PARAM] = pollux_ramp_level_param;
-    alt_mode_button_param = configParam<ReplaceableLabelParamQuantity>(
-        ALT_MODE_BUTTON_PARAM, 0.f, 1.f, 0.f, "Alt Mode switch");
-    paramIdToParam[ALT_MODE_BUTTON_PARAM] = alt_mode_button_param;
-    filter_enable_button_param = configParam<ReplaceableLabelParamQuantity>(
-        FILTER_ENABLE_BUTTON_PARAM, 0.f, 1.f, 1.f, "Enable filtering switch");
-    paramIdToParam[FILTER_ENABLE_BUTTON_PARAM] = filter_enable_button_param;
-
-    for (int paramInt = CASTOR_PITCH_PARAM; paramInt != PARAMS_LEN;
-         ++paramInt) {
-      ParamId p = static_cast<ParamId>(paramInt);
-
-      paramIdToParam[p]->setLabel(getParamLabel(this->altMode, this->mode, p));
-    }
-
-    configInput(CASTOR_DUTY_INPUT, "Castor duty");
-    configInput(POLLUX_DUTY_INPUT, "Pollux duty");
-    configInput(CASTOR_PITCH_INPUT, "Castor pitch");
-    configInput(POLLUX_PITCH_INPUT, "Pollux pitch");
-
-    configOutput(CASTOR_MIX_OUTPUT, "Castor");
-    configOutput(MIX_OUTPUT, "Mix");
-    configOutput(POLLUX_MIX_OUTPUT, "Pollux");
-  }
-
-  json_t* dataToJson() override {
-    json_t* rootJ = json_object();
-    for (size_t paramInt = CASTOR_PITCH_PARAM; paramInt != PARAMS_LEN;
-         ++paramInt) {
-      ParamId param = static_cast<ParamId>(paramInt);
-      for (size_t modeInt = 0; modeInt < 4; ++modeInt) {
-        Mode mode = static_cast<Mode>(modeInt);
-        std::string name;
-        sprintf(&name[0], "%ld/%ld/%d", paramInt, modeInt, true);
-        json_t* val = json_real(
-            static_cast<double>(this->getParamRef(true, mode, param)));
-        json_object_set_new(rootJ, name.c_str(), val);
-        sprintf(&name[0], "%ld/%ld/%d", paramInt, modeInt, false);
-        val = json_real(
-            static_cast<double>(this->getParamRef(false, mode, param)));
-        json_object_set_new(rootJ, name.c_str(), val);
-      }
-    }
-    return rootJ;
-  }
-
-  void dataFromJson(json_t* rootJ) override {
-    const char* key;
-    json_t* value;
-    json_object_foreach(rootJ, key, value) {
-      int32_t paramInt, modeInt, altModeInt;
-      sscanf(key, "%d/%d/%d", &paramInt, &modeInt, &altModeInt);
-      this->getParamRef(
-          static_cast<bool>(altModeInt), static_cast<Mode>(modeInt),
-          static_cast<ParamId>(paramInt)) = json_number_value(value);
-    }
-  }
-
-  float& getParamRef(ParamId param) {
-    return this->getParamRef(this->altMode, this->mode, param);
-  }
-
-  std::string getParamLabel(bool altMode, Mode lfoMode, ParamId param) {
-    switch (param) {
-      case CASTOR_PITCH_PARAM:
-        return "Castor Pitch";
-      case POLLUX_PITCH_PARAM:
-        return lfoMode == HARD_SYNC ? "Pollux Pitch Ratio" : "Pollux Pitch";
-      case CASTOR_RAMP_LEVEL_PARAM:
-        return "Castor ramp level";
-      case CASTOR_PULSE_LEVEL_PARAM:
-        return "Castor Pulse Level";
-      case POLLUX_PULSE_LEVEL_PARAM:
-        return "Pollux Pulse Level";
-      case BUTTON_PARAM:
-        switch (lfoMode) {
-          case CHORUS:
-            return "Mode - Chorus";
-          case LFO_PWM:
-            return "Mode - LFO PWM";
-          case LFO_FM:
-            return "Mode - LFO FM";
-          case HARD_SYNC:
-            return "Mode - Hard Sync";
-        }
-      case CASTOR_SUB_LEVEL_PARAM:
-        return "Castor Sub Level";
-      case POLLUX_SUB_LEVEL_PARAM:
-        return "Pollux Sub Level";
-      case POLLUX_RAMP_LEVEL_PARAM:
-        return "Pollux Ramp Level";
-      case ALT_MODE_BUTTON_PARAM:
-        return altMode ? "Alt mode - enabled" : "Alt mode - disabled";
-      case CROSSFADE_PARAM:
-        return "Crossfade";
-      case CASTOR_DUTY_PARAM:
-        if (lfoMode == LFO_PWM && altMode) {
-          return "Castor pulse width centre position";
-        }
-        return "Castor Duty ratio";
-
-      case POLLUX_DUTY_PARAM:
-        if (lfoMode == LFO_PWM && altMode) {
-          return "Pollux pulse width centre position";
-        }
-        return "Pollux Duty ratio";
-      case LFO_PARAM:
-        switch (lfoMode) {
-          case CHORUS:
-            return altMode ? "LFO amplitude level" : "LFO frequency";
-          case LFO_PWM:
-            return "LFO PWM frequency";
-          case LFO_FM:
-            return "LFO FM frequency";
-          case HARD_SYNC:
-            return "LFO hard sync frequency";
-        }
-      case FILTER_ENABLE_BUTTON_PARAM:
-        return this->enableFilter == 1.f ? "Filter mode - enabled"
-                                         : "Filter mode - disabled";
-      case PARAMS_LEN:
-        return "NOOOOOO";
-    }
-  }
-
-  float& getParamRef(bool altMode, Mode lfoMode, ParamId param) {
-    switch (param) {
-      case CASTOR_PITCH_PARAM:
-        return castorPitchParam;
-      case POLLUX_PITCH_PARAM:
-        return lfoMode == HARD_SYNC ? polluxPitchMultiplier : polluxPitchParam;
-      case CASTOR_RAMP_LEVEL_PARAM:
-        return castorRampLevelParam;
-      case CASTOR_PULSE_LEVEL_PARAM:
-        return castorPulseLevelParam;
-      case POLLUX_PULSE_LEVEL_PARAM:
-        return polluxPulseLevelParam;
-      case BUTTON_PARAM:
-        return buttonParam;
-      case CASTOR_SUB_LEVEL_PARAM:
-        return castorSubParam;
-      case POLLUX_SUB_LEVEL_PARAM:
-        return polluxSubParam;
-      case POLLUX_RAMP_LEVEL_PARAM:
-        return polluxRampLevelParam;
-      case ALT_MODE_BUTTON_PARAM:
-        return altModeParam;
-      case CROSSFADE_PARAM:
-        return crossfadeParam;
-      case CASTOR_DUTY_PARAM:
-        switch (lfoMode) {
-          case CHORUS:
-            return castorDutyParam;
-          case LFO_PWM:
-            return altMode ? lfoPwmCastorPulseWidthCentre : castorDutyParam;
-          case LFO_FM:
-            return castorDutyParam;
-          case HARD_SYNC:
-            return castorDutyParam;
-        }
-      case POLLUX_DUTY_PARAM:
-        switch (lfoMode) {
-          case CHORUS:
-            return polluxDutyParam;
-          case LFO_PWM:
-            return altMode ? lfoPwmPolluxPulseWidthCentre : polluxDutyParam;
-          case LFO_FM:
-            return polluxDutyParam;
-          case HARD_SYNC:
-            return polluxDutyParam;
-        }
-      case LFO_PARAM:
-        switch (lfoMode) {
-          case CHORUS:
-            return altMode ? lfoAmplitudeValue : lfoChorusFreqCv;
-          case LFO_PWM:
-            return lfoPwmFreqCv;
-          case LFO_FM:
-            return lfoFmFreqCv;
-          case HARD_SYNC:
-            return lfoHardSyncFreqCv;
-        }
-      case FILTER_ENABLE_BUTTON_PARAM:
-        return enableFilter;
-      case PARAMS_LEN:
-        return paramsLen;
-    }
-  }
-
-  Mode getMode() { return this->mode; }
-
-  void updateParams() {
-    bool nowAltMode = params[ALT_MODE_BUTTON_PARAM].getValue() == 1.f;
-    Mode nowMode = static_cast<Mode>(
-        static_cast<int32_t>(params[BUTTON_PARAM].getValue()));
-
-    if (nowAltMode != altMode || nowMode != mode) {
-      // Assume that users cannot click between the alt mode button and the
-      // UI controls within 2ms. Update the controls with the alt-mode (or
-      // standard) mode values (so that they know what they're altering).
-      this->altMode = nowAltMode;
-      this->mode = nowMode;
-      for (int paramInt = CASTOR_PITCH_PARAM; paramInt != PARAMS_LEN;
-           ++paramInt) {
-        ParamId p = static_cast<ParamId>(paramInt);
-        if (p == BUTTON_PARAM || p == ALT_MODE_BUTTON_PARAM) {
-          continue;
-        }
-        float& ref = this->getParamRef(nowAltMode, nowMode, p);
-        params[p].setValue(ref);
-      }
-    } else {
-      for (int paramInt = CASTOR_PITCH_PARAM; paramInt != PARAMS_LEN;
-           ++paramInt) {
-        ParamId p = static_cast<ParamId>(paramInt);
-        float& ref = this->getParamRef(nowAltMode, nowMode, p);
-        ref = params[p].getValue();
-        paramIdToParam[p]->setLabel(
-            getParamLabel(this->altMode, this->mode, p));
-      }
-    }
-    castor.enableFilter(1.f == this->getParamRef(FILTER_ENABLE_BUTTON_PARAM));
-    pollux.enableFilter(1.f == this->getParamRef(FILTER_ENABLE_BUTTON_PARAM));
-  }
-
-  /*
-   * Main logic thread
-   *
-   * Gemini is made up of two oscillators - Castor and Pollux. Castor can be
-   * thought of as the main driving oscillator, with its frequency influencing
-   * the frequency of Pollux (unless a separate CV input is provided).
-   *
-   * Each mode has a different behaviour:
-   *   * Chorus - subtle frequency modulation of Pollux only.
-   *   * LFO PWM - pulse width influenced by LFO output.
-   *   * LFO FM - frequency influenced by LFO output.
-   *   * Hard sync - Pollux gets reset every time Castor does. Pollux's
-   *       frequency becomes a multiple of Castor's.
-   *
-   * Update user-driven parameters every 128 ticks - this saves some resources
-   * and should be imperceptible to the vast majority of users.
-   *
-   * Update the pitch of the oscillators each tick, as they are externally
-   * driven and can change more frequently. The oscillators need updating every
-   * tick to ensure a smooth output.
-   *
-   * When the oscillators' frequency changes, keep the same phase to ensure a
-   * smooth transition between different frequencies.
-   */
-  void process(const ProcessArgs& args) override {
-    if (args.frame % 128 == 0) {
-      updateParams();
-    }
-
-    lfo.updatePitch(this->getLfoCv());
-    lfo.updatePhase(args.sampleTime);
-
-    castor.updatePitch(this->getCastorPitchCv());
-    bool castorReset = castor.updatePhase(args.sampleTime);
-
-    pollux.updatePitch(this->getPolluxPitchCv());
-    if (mode == HARD_SYNC && castorReset) {
-      pollux.resetPhase();
-    } else {
-      pollux.updatePhase(args.sampleTime);
-    }
-
-    Signals castorSignals = castor.getSignals(this->getCastorDutyCycle(),
-                                              this->getCastorPulseOffset());
-    Signals castorMix = this->getCastorMix();
-
-    // Audio signals are typically +/-5V
-    // https://vcvrack.com/manual/VoltageStandards
-    float castorOut = castor.getOutput(castorSignals, castorMix);
-    outputs[CASTOR_MIX_OUTPUT].setVoltage(castorOut);
-
-    // Pollux's behaviour generally depends on the current mode.
-    Signals polluxSignals = pollux.getSignals(this->getPolluxDutyCycle(),
-                                              this->getPolluxPulseOffset());
-    Signals polluxMix = this->getPolluxMix();
-    float polluxOut = pollux.getOutput(polluxSignals, polluxMix);
-    outputs[POLLUX_MIX_OUTPUT].setVoltage(polluxOut);
-
-    outputs[MIX_OUTPUT].setVoltage(
-        this->getMix(castorOut, polluxOut, this->getParamRef(CROSSFADE_PARAM)));
-  }
-
-  void onSampleRateChange(const SampleRateChangeEvent& e) override {
-    castor.updateSampleRate(e.sampleRate);
-    pollux.updateSampleRate(e.sampleRate);
-  }
-
- private:
-  float getCastorPulseOffset() {
-    return this->getPulseOffset(/*isCastor=*/true);
-  }
-
-  float getPolluxPulseOffset() {
-    return this->getPulseOffset(/*isCastor=*/false);
-  }
-
-  float getPulseOffset(bool isCastor) {
-    return this->getMode() == LFO_PWM
-               ? this->getParamRef(
-                     true, LFO_PWM,
-                     isCastor ? CASTOR_DUTY_PARAM : POLLUX_DUTY_PARAM)
-               : 0.f;
-  }
-
-  float getMix(float castor, float pollux, float mix) {
-    return rack::simd::crossfade(castor, pollux, mix);
-  }
-
-  Signals getCastorMix() {
-    return this->getMix(CASTOR_RAMP_LEVEL_PARAM, CASTOR_PULSE_LEVEL_PARAM,
-                        CASTOR_SUB_LEVEL_PARAM);
-  }
-
-  Signals getPolluxMix() {
-    return this->getMix(POLLUX_RAMP_LEVEL_PARAM, POLLUX_PULSE_LEVEL_PARAM,
-                        POLLUX_SUB_LEVEL_PARAM);
-  }
-
-  Signals getMix(ParamId ramp, ParamId pulse, ParamId sub) {
-    return {
-        this->getParamRef(ramp),
-        this->getParamRef(pulse),
-        this->getParamRef(sub),
-    };
-  }
-
-  // Returns a value in [0, 1.f].
-  float getDutyCycle(InputId input, ParamId param) {
-    float baseDutyCycle =
-        this->getParamRef(param) + inputs[input].getNormalVoltage(0.f) / 5.f;
-    if (this->getMode() == LFO_PWM) {
-      // LFO Value \in [-1, 1]
-      baseDutyCycle += this->getLfoValue();
-    }
-
-    return rack::math::clamp(baseDutyCycle, -1.f, 1.f);
-  }
-
-  float getCastorDutyCycle() {
-    return this->getDutyCycle(CASTOR_DUTY_INPUT, CASTOR_DUTY_PARAM);
-  }
-
-  float getPolluxDutyCycle() {
-    return this->getDutyCycle(POLLUX_DUTY_INPUT, POLLUX_DUTY_PARAM);
-  }
-
-  float getCastorPitchCv() {
-    float basePitch = this->getCastorPitchCvBase();
-    if (getMode() != LFO_FM) {
-      return basePitch;
-    }
-    float lfoValue = this->getLfoValue();
-    return basePitch + lfoValue;
-  }
-
-  float getCastorPitchCvBase() {
-    if (inputs[CASTOR_PITCH_INPUT].isConnected()) {
-      // Return Castor pitch with a the offset from the knob.
-      return inputs[CASTOR_PITCH_INPUT].getVoltage() +
-             params[CASTOR_PITCH_PARAM].getValue();
-    } else {
-      // Quantize the knob output.
-      // When there's no input to Castor, it has a +/- 3 Oct swing.
-      float pitchCv = getParamRef(altMode, mode, CASTOR_PITCH_PARAM) * 3.f;
-      float remainder = std::remainderf(pitchCv, 1.f / 12.f);
-      return pitchCv - remainder;
-    }
-  }
-
-  float getLfoValue() {
-    // We need to attenuate it based on the LFO_PARAM
-    float value = this->lfo.triangle();  // in [-1, 1)
-    if (this->getMode() == CHORUS || this->getMode() == HARD_SYNC) {
-      value *= std::log(getParamRef(false, this->getMode(), LFO_PARAM) + 1);
-    }
-    return value;
-  }
-
-  // Current value determining the frequency of the LFO
-  float getLfoCv() {
-    // Param \in [-1, 1]
-    float param = this->getParamRef(this->getMode() == CHORUS || altMode,
-                                    this->getMode(), LFO_PARAM);
-    return 5.f * (param + 1.f);
-  }
-
-  float getPolluxPitchCv() {
-    float polluxBasePitchCv = this->getPolluxBasePitchCv();
-    if (this->getMode() == HARD_SYNC) {
-      auto basePitchCv =
-          inputs[POLLUX_PITCH_PARAM].isConnected()
-              ? (rack::math::clamp(inputs[POLLUX_PITCH_PARAM].getVoltage(),
-                                   -6.f, 6.f))
-              : this->getCastorPitchCv();
-      return basePitchCv + ((1.f + getParamRef(POLLUX_PITCH_PARAM)) * 1.5f);
-    }
-    if (this->getMode() == CHORUS) {
-      return polluxBasePitchCv + this->getLfoValue();
-    }
-    // switch (this->getMode()) { case CHORUS: case HARD_SYNC: }
-    return polluxBasePitchCv;
-  }
-
-  float getPolluxBasePitchCv() {
-    float mainPitchCv = inputs[POLLUX_PITCH_INPUT].isConnected()
-                            ? inputs[POLLUX_PITCH_INPUT].getVoltage()
-                            : this->getCastorPitchCv();
-
-    return mainPitchCv + params[POLLUX_PITCH_PARAM].getValue();
-  }
-};
+#include "Gemini.hpp"
 
 struct GeminiWidget : ModuleWidget {
   GeminiWidget(Gemini* module) {
     setModule(module);
     setPanel(createPanel(asset::plugin(pluginInstance, "res/Gemini.svg")));
 
-    addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, 0)));
-    addChild(
-        createWidget<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, 0)));
-    addChild(createWidget<ScrewSilver>(
-        Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
-    addChild(createWidget<ScrewSilver>(Vec(
-        box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
-
-    addParam(createParamCentered<RoundHugeBlackKnob>(
-        mm2px(Vec(16.48, 21.259)), module, Gemini::CASTOR_PITCH_PARAM));
-    addParam(createParamCentered<RoundHugeBlackKnob>(
-        mm2px(Vec(54.08, 21.259)), module, Gemini::POLLUX_PITCH_PARAM));
-    addParam(createParamCentered<RoundBigBlackKnob>(mm2px(Vec(35.28, 42.455)),
-                                                    module, Gemini::LFO_PARAM));
-    addParam(createParamCentered<RoundBigBlackKnob>(
-        mm2px(Vec(12.331, 52.077)), module, Gemini::CASTOR_DUTY_PARAM));
-    addParam(createParamCentered<RoundBigBlackKnob>(
-        mm2px(Vec(58.198, 52.077)), module, Gemini::POLLUX_DUTY_PARAM));
-    addParam(createParamCentered<RoundBigBlackKnob>(
-        mm2px(Vec(35.28, 64.716)), module, Gemini::CROSSFADE_PARAM));
-    addParam(createParamCentered<RoundBlackKnob>(
-        mm2px(Vec(7.854, 80.97)), module, Gemini::CASTOR_RAMP_LEVEL_PARAM));
-    addParam(createParamCentered<RoundBlackKnob>(
-        mm2px(Vec(21.536, 80.97)), module, Gemini::CASTOR_PULSE_LEVEL_PARAM));
-    addParam(createParamCentered<RoundBlackKnob>(
-        mm2px(Vec(62.447, 80.97)), module, Gemini::POLLUX_RAMP_LEVEL_PARAM));
-    addParam(createParamCentered<RoundBlackKnob>(
-        mm2px(Vec(21.536, 95.994)), module, Gemini::CASTOR_SUB_LEVEL_PARAM));
-    addParam(createParamCentered<RoundBlackKnob>(
-        mm2px(Vec(48.834, 95.994)), module, Gemini::POLLUX_SUB_LEVEL_PARAM));
-    addParam(createParamCentered<RoundBlackKnob>(
-        mm2px(Vec(48.834, 80.97)), module, Gemini::POLLUX_PULSE_LEVEL_PARAM));
-    addParam(createParamCentered<RoundBlackSnapKnob>(
-        mm2px(Vec(35.25, 88.806)), module, Gemini::BUTTON_PARAM));
-    addParam(createParamCentered<VCVLatch>(mm2px(Vec(35.25, 99.963)), module,
-                                           Gemini::ALT_MODE_BUTTON_PARAM));
-
-    addParam(createParamCentered<VCVLatch>(mm2px(Vec(35.25, 15.00)), module,
-                                           Gemini::FILTER_ENABLE_BUTTON_PARAM));
-
-    addInput(createInputCentered<PJ301MPort>(mm2px(Vec(7.854, 95.994)), module,
-                                             Gemini::CASTOR_DUTY_INPUT));
-    addInput(createInputCentered<PJ301MPort>(mm2px(Vec(62.477, 95.994)), module,
-                                             Gemini::POLLUX_DUTY_INPUT));
-    addInput(createInputCentered<PJ301MPort>(mm2px(Vec(7.854, 111.12)), module,
-                                             Gemini::CASTOR_PITCH_INPUT));
-    addInput(createInputCentered<PJ301MPort>(mm2px(Vec(62.447, 111.12)), module,
-                                             Gemini::POLLUX_PITCH_INPUT));
-
-    addOutput(createOutputCentered<PJ301MPort>(
-        mm2px(Vec(21.536, 111.12)), module, Gemini::CASTOR_MIX_OUTPUT));
-    addOutput(createOutputCentered<PJ301MPort>(mm2px(Vec(35.239, 111.12)),
-                                               module, Gemini::MIX_OUTPUT));
-    addOutput(createOutputCentered<PJ301MPort>(
-        mm2px(Vec(48.761, 111.12)), module, Gemini::POLLUX_MIX_OUTPUT));
+    addGeminiControls(this, module);
+  }
+
+  void appendContextMenu(Menu* menu) override {
+    Gemini* module = getModule<Gemini>();
+
+    menu->addChild(new MenuSeparator);
+    menu->addChild(createBoolMenuItem(
+        "Band-limited waveforms", "",
+        [=]() { return module->bandLimited.load(std::memory_order_relaxed); },
+        [=](bool enabled) {
+          module->bandLimited.store(enabled, std::memory_order_relaxed);
+        }));
+    menu->addChild(createIndexSubmenuItem(
+        "Oversampling", {"1x", "2x", "4x", "8x"},
+        [=]() {
+          return static_cast<size_t>(
+              std::log2(module->oversampling.load(std::memory_order_relaxed)));
+        },
+        [=](size_t index) {
+          module->oversampling.store(1 << index, std::memory_order_relaxed);
+        }));
+
+    std::vector<std::string> unisonLabels = {"Off"};
+    for (int copies = 2; copies <= Gemini::MAX_UNISON; copies++) {
+      unisonLabels.push_back(std::to_string(copies) + " copies");
+    }
+    menu->addChild(createIndexSubmenuItem(
+        "Unison", unisonLabels,
+        [=]() {
+          return static_cast<size_t>(
+              module->unison.load(std::memory_order_relaxed) - 1);
+        },
+        [=](size_t index) {
+          module->unison.store(index + 1, std::memory_order_relaxed);
+        }));
+    std::vector<std::string> detuneLabels;
+    for (float cents : Gemini::UNISON_DETUNES) {
+      detuneLabels.push_back(std::to_string(static_cast<int>(cents)) +
+                             " cents");
+    }
+    const auto& detunes = Gemini::UNISON_DETUNES;
+    menu->addChild(createIndexSubmenuItem(
+        "Unison detune", detuneLabels,
+        [=]() {
+          return static_cast<size_t>(
+              std::find(detunes.begin(), detunes.end(),
+                        module->unisonDetune.load(std::memory_order_relaxed)) -
+              detunes.begin());
+        },
+        [=](size_t index) {
+          module->unisonDetune.store(detunes[index], std::memory_order_relaxed);
+        }));
+  }
+
+  void step() override {
+    if (Gemini* module = getModule<Gemini>()) {
+      module->refreshLabels();
+    }
+    ModuleWidget::step();
   }
 };
 
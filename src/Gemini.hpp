@@ -0,0 +1,2621 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <type_traits>
+
+#include "approx.hpp"
+#include "engine/ParamQuantity.hpp"
+#include "plugin.hpp"
+#include "wide.hpp"
+
+// One value per waveform; T is float, a simd vector (one voice per lane), or
+// bool for which waveforms are heard.
+template <typename T>
+struct Signals {
+  T ramp;
+  T pulse;
+  T sub;
+};
+
+// Which waveforms are heard at these levels.
+inline Signals<bool> isHeard(const Signals<float>& amplitude) {
+  return {amplitude.ramp != 0.f, amplitude.pulse != 0.f, amplitude.sub != 0.f};
+}
+
+// Which waveforms are heard in some lane, for levels that differ per lane.
+template <wide::FloatVector V>
+Signals<bool> isHeard(const Signals<V>& amplitude) {
+  return {wide::movemask(amplitude.ramp != 0.f) != 0,
+          wide::movemask(amplitude.pulse != 0.f) != 0,
+          wide::movemask(amplitude.sub != 0.f) != 0};
+}
+
+// Which waveforms are heard at some point while the levels move between two.
+template <typename A>
+Signals<bool> isHeard(const Signals<A>& from, const Signals<A>& to) {
+  const Signals<bool> heardFrom = isHeard(from);
+  const Signals<bool> heardTo = isHeard(to);
+  return {heardFrom.ramp || heardTo.ramp, heardFrom.pulse || heardTo.pulse,
+          heardFrom.sub || heardTo.sub};
+}
+
+inline bool anyHeard(const Signals<bool>& heard) {
+  return heard.ramp || heard.pulse || heard.sub;
+}
+
+struct ReplaceableLabelParamQuantity : ParamQuantity {
+  std::string getLabel() override { return this->contents; }
+
+  void setLabel(std::string s) { this->contents = s; }
+
+ private:
+  std::string contents;
+};
+
+inline constexpr float rampCapacitorDecayFn(
+    const float phase) {                         // phase \in [-1, 1]
+  const float exponent = phase - 1.f;            // exponent in [0, -2]
+  const float decay = constexprExp2(exponent);   // decay \in [1, 0.25];
+  const float offset = decay - 0.25f;            // offset \in [0.75, 0]
+  const float stretchFactor = 2.f / 0.75f;
+  const float stretch = offset * stretchFactor;  // stretch \in [2, 0]
+  return stretch - 1.f;
+}
+
+// The ramp, rampCapacitorDecayFn(-phase), sampled at evenly spaced phases
+// covering [-1, 1]. The table is indexed by phase alone, so it is the same at
+// every sample rate.
+const static int DECAY_TABLE_SIZE = 512;
+
+using DecayTable = std::array<float, DECAY_TABLE_SIZE + 1>;
+
+constexpr DecayTable calculateRampDecayTable() {
+  DecayTable table{};
+  for (int32_t i = 0; i <= DECAY_TABLE_SIZE; i++) {
+    const float phase = 2.f * i / DECAY_TABLE_SIZE - 1.f;
+    table[i] = rampCapacitorDecayFn(-phase);
+  }
+  return table;
+}
+
+inline constexpr DecayTable rampCapacitorDecay = calculateRampDecayTable();
+
+constexpr float rampWavetableValue(float phase) {  // phase in [-1, 1]
+  const float position = (phase + 1.f) * (DECAY_TABLE_SIZE / 2.f);
+  const int32_t index =
+      std::clamp(static_cast<int32_t>(position), 0, DECAY_TABLE_SIZE - 1);
+  const float fraction = position - index;
+  return rampCapacitorDecay[index] +
+         (rampCapacitorDecay[index + 1] - rampCapacitorDecay[index]) * fraction;
+}
+
+// Largest difference between the interpolated table and rampCapacitorDecayFn,
+// checked at many more phases than the table holds.
+constexpr float rampWavetableError() {
+  float error = 0.f;
+  for (int32_t i = 0; i <= 16 * DECAY_TABLE_SIZE; i++) {
+    const float phase = 2.f * i / (16 * DECAY_TABLE_SIZE) - 1.f;
+    const float difference =
+        rampWavetableValue(phase) - rampCapacitorDecayFn(-phase);
+    error = std::max(error, difference < 0.f ? -difference : difference);
+  }
+  return error;
+}
+
+// The previous 96000 sample table, read without interpolation, was only
+// within 3.9e-5.
+static_assert(rampWavetableError() < 5e-6f,
+              "Ramp decay table is less accurate than expected");
+
+// Only the table reads go lane by lane; the index and interpolation are
+// vectorised.
+template <wide::FloatVector Float>
+Float rampWavetableValue(Float phase) {
+  const Float position = (phase + 1.f) * (DECAY_TABLE_SIZE / 2.f);
+  const wide::IntOf<Float> index(
+      wide::clamp(position, 0.f, DECAY_TABLE_SIZE - 1.f));
+  Float below, above;
+  for (int i = 0; i < Float::size; i++) {
+    below[i] = rampCapacitorDecay[index[i]];
+    above[i] = rampCapacitorDecay[index[i] + 1];
+  }
+  return below + (above - below) * (position - Float(index));
+}
+
+// Band-limited copies of the capacitor decay ramp, one per octave. Level j
+// holds the first MAX_HARMONICS >> j harmonics, which stay below Nyquist while
+// the phase advances by less than 2^j / MAX_HARMONICS per sample.
+struct RampMipmap {
+  static constexpr int SIZE = 2048;
+  static constexpr int LEVELS = 10;
+  static constexpr int MAX_HARMONICS = 1 << (LEVELS - 1);
+
+  // One extra sample at the end so interpolation never needs to wrap.
+  std::array<std::array<float, SIZE + 1>, LEVELS> levels;
+
+  RampMipmap() {
+    // Over one cycle u \in [0, 1), the ramp is
+    //   rampCapacitorDecayFn(1 - 2u) = 8/3 e^(-cu) - 5/3,  c = 2 ln(2),
+    // which has the Fourier series
+    //   1 / ln(2) - 5/3
+    //     + sum_h (4c cos(2 pi h u) + 8 pi h sin(2 pi h u)) / (c^2 + 4 pi^2 h^2)
+    const double c = 2.0 * std::log(2.0);
+    for (int i = 0; i < SIZE; i++) {
+      const double u = static_cast<double>(i) / SIZE;
+      double sum = 1.0 / std::log(2.0) - 5.0 / 3.0;
+      int level = LEVELS - 1;
+      for (int h = 1; h <= MAX_HARMONICS; h++) {
+        const double w = 2.0 * M_PI * h;
+        sum += (4.0 * c * std::cos(w * u) + 4.0 * w * std::sin(w * u)) /
+               (c * c + w * w);
+        if (h == MAX_HARMONICS >> level) {
+          levels[level][i] = sum;
+          level--;
+        }
+      }
+    }
+    for (auto& level : levels) {
+      level[SIZE] = level[0];
+    }
+  }
+
+  // phase \in [-1, 1), increment is the phase advanced per sample.
+  float value(float phase, float increment) const {
+    const int level = rack::math::clamp(
+        std::ilogb(increment * MAX_HARMONICS) + 1, 0, LEVELS - 1);
+    const float position = (phase + 1.f) * (SIZE / 2.f);
+    const int index = rack::math::clamp(static_cast<int>(position), 0, SIZE - 1);
+    const float fraction = position - index;
+    return rack::math::crossfade(levels[level][index], levels[level][index + 1],
+                                 fraction);
+  }
+};
+
+// Built on first use rather than when the plugin is loaded.
+inline const RampMipmap& rampMipmap() {
+  static const RampMipmap mipmap;
+  return mipmap;
+}
+
+inline float rampMipmapValue(float phase, float increment) {
+  return rampMipmap().value(phase, increment);
+}
+
+// As RampMipmap::value(), with the table offsets worked out in vectors.
+template <wide::FloatVector Float>
+Float rampMipmapValue(Float phase, Float increment) {
+  using Int = wide::IntOf<Float>;
+  constexpr int STRIDE = RampMipmap::SIZE + 1;
+  static_assert(sizeof(RampMipmap::levels) ==
+                RampMipmap::LEVELS * STRIDE * sizeof(float));
+  const float* samples = rampMipmap().levels[0].data();
+  // std::ilogb() + 1 from the exponent bits, which is exact for increments:
+  // they're finite and never negative.
+  const Float octave = Float(
+      (Int::cast(increment * RampMipmap::MAX_HARMONICS) >> 23) - 126);
+  const Float level = wide::clamp(octave, 0.f, RampMipmap::LEVELS - 1.f);
+  const Float position = (phase + 1.f) * (RampMipmap::SIZE / 2.f);
+  const Float index =
+      Float(Int(wide::clamp(position, 0.f, RampMipmap::SIZE - 1.f)));
+  const Int offset(level * STRIDE + index);
+  Float below, above;
+  for (int i = 0; i < Float::size; i++) {
+    below[i] = samples[offset[i]];
+    above[i] = samples[offset[i] + 1];
+  }
+  return below + (above - below) * (position - index);
+}
+
+// PolyBLEP residual for a unit step at a distance of t samples, where t is
+// negative before the step. Zero outside of (-1, 1).
+template <typename T>
+T polyBlep(T t) {
+  T a = wide::fmax(1.f - wide::fabs(t), 0.f);
+  return wide::ifelse(t < 0.f, 0.5f, -0.5f) * a * a;
+}
+
+// PolyBLAMP residual for a unit change of slope (per sample) at a distance of
+// t samples. Zero outside of (-1, 1).
+template <typename T>
+T polyBlamp(T t) {
+  T a = wide::fmax(1.f - wide::fabs(t), 0.f);
+  return a * a * a / 6.f;
+}
+
+// Designs the coefficients of a polyphase IIR half-band filter made of two
+// chains of first order allpass sections, as in Laurent de Soras' HIIR.
+// transition is the width of the transition band either side of a quarter of
+// the sample rate, as a fraction of the sample rate.
+template <int N>
+std::array<float, N> designHalfBand(double transition) {
+  auto ipow = [](double x, int n) {
+    double z = 1.0;
+    for (; n > 0; n >>= 1, x *= x) {
+      if (n & 1) {
+        z *= x;
+      }
+    }
+    return z;
+  };
+
+  double k = std::tan((1.0 - transition * 2.0) * M_PI / 4.0);
+  k *= k;
+  const double kkSqrt = std::pow(1.0 - k * k, 0.25);
+  const double e = 0.5 * (1.0 - kkSqrt) / (1.0 + kkSqrt);
+  const double e4 = e * e * e * e;
+  const double q = e * (1.0 + e4 * (2.0 + e4 * (15.0 + 150.0 * e4)));
+  const int order = N * 2 + 1;
+
+  std::array<float, N> coefficients;
+  for (int index = 0; index < N; index++) {
+    const int c = index + 1;
+    double numerator = 0.0;
+    for (int i = 0, sign = 1;; i++, sign = -sign) {
+      const double term = ipow(q, i * (i + 1)) *
+                          std::sin((i * 2 + 1) * c * M_PI / order) * sign;
+      numerator += term;
+      if (std::fabs(term) < 1e-100) {
+        break;
+      }
+    }
+    numerator *= std::pow(q, 0.25);
+    double denominator = 0.5;
+    for (int i = 1, sign = -1;; i++, sign = -sign) {
+      const double term =
+          ipow(q, i * i) * std::cos(i * 2 * c * M_PI / order) * sign;
+      denominator += term;
+      if (std::fabs(term) < 1e-100) {
+        break;
+      }
+    }
+    const double ww = numerator / denominator;
+    const double wwSquared = ww * ww;
+    const double x = std::sqrt((1.0 - wwSquared * k) * (1.0 - wwSquared / k)) /
+                     (1.0 + wwSquared);
+    coefficients[index] = (1.0 - x) / (1.0 + x);
+  }
+  return coefficients;
+}
+
+// The last 2x stage passes up to 0.2075 of its input rate (19.9kHz at 48kHz)
+// and attenuates from 0.2925 by 76dB.
+inline const std::array<float, 6>& finalHalfBandCoefficients() {
+  static const std::array<float, 6> coefficients = designHalfBand<6>(0.0425);
+  return coefficients;
+}
+
+// Earlier stages only need to keep the audible band, leaving them a much wider
+// transition band: 83dB of attenuation from 0.395 of their input rate.
+inline const std::array<float, 4>& earlyHalfBandCoefficients() {
+  static const std::array<float, 4> coefficients = designHalfBand<4>(0.145);
+  return coefficients;
+}
+
+// Halves the sample rate, costing N multiplies per output sample.
+template <typename T, int N>
+class HalfBandDecimator {
+  template <typename, int>
+  friend class HalfBandDecimator;
+
+  const std::array<float, N>& coefficients;
+  std::array<T, N> x{};
+  std::array<T, N> y{};
+
+ public:
+  HalfBandDecimator(const std::array<float, N>& coefficients)
+      : coefficients(coefficients) {}
+
+  void reset() {
+    x.fill(0.f);
+    y.fill(0.f);
+  }
+
+  // See gatherVoices(). The coefficients are the same for every width.
+  template <typename Wide, typename Narrow, typename Lanes, typename Shared>
+  static void visitVoices(Wide& wide, Narrow& narrow, Lanes lanes, Shared) {
+    for (int i = 0; i < N; i++) {
+      lanes(wide.x[i], narrow.x[i]);
+      lanes(wide.y[i], narrow.y[i]);
+    }
+  }
+
+  // Even coefficients filter the later sample, odd ones the earlier sample.
+  T process(T first, T second) {
+    T paths[2] = {second, first};
+    for (int i = 0; i < N; i++) {
+      T& path = paths[i % 2];
+      T out = (path - y[i]) * coefficients[i] + x[i];
+      x[i] = path;
+      y[i] = out;
+      path = out;
+    }
+    return 0.5f * (paths[0] + paths[1]);
+  }
+};
+
+// Brings 1x, 2x, 4x or 8x oversampled audio back to the engine's sample rate
+// with a cascade of half-band filters.
+template <typename T>
+class Decimator {
+  template <typename>
+  friend class Decimator;
+
+  HalfBandDecimator<T, 4> from8x{earlyHalfBandCoefficients()};
+  HalfBandDecimator<T, 4> from4x{earlyHalfBandCoefficients()};
+  HalfBandDecimator<T, 6> from2x{finalHalfBandCoefficients()};
+
+ public:
+  static constexpr int MAX_OVERSAMPLING = 8;
+
+  void reset() {
+    from8x.reset();
+    from4x.reset();
+    from2x.reset();
+  }
+
+  // See gatherVoices().
+  template <typename Wide, typename Narrow, typename Lanes, typename Shared>
+  static void visitVoices(Wide& wide, Narrow& narrow, Lanes lanes,
+                          Shared shared) {
+    HalfBandDecimator<T, 4>::visitVoices(wide.from8x, narrow.from8x, lanes,
+                                         shared);
+    HalfBandDecimator<T, 4>::visitVoices(wide.from4x, narrow.from4x, lanes,
+                                         shared);
+    HalfBandDecimator<T, 6>::visitVoices(wide.from2x, narrow.from2x, lanes,
+                                         shared);
+  }
+
+  // Consumes the `oversampling` samples in `in`, oldest first.
+  T process(T* in, int oversampling) {
+    if (oversampling >= 8) {
+      for (int i = 0; i < 4; i++) {
+        in[i] = from8x.process(in[2 * i], in[2 * i + 1]);
+      }
+    }
+    if (oversampling >= 4) {
+      for (int i = 0; i < 2; i++) {
+        in[i] = from4x.process(in[2 * i], in[2 * i + 1]);
+      }
+    }
+    if (oversampling >= 2) {
+      in[0] = from2x.process(in[0], in[1]);
+    }
+    return in[0];
+  }
+};
+
+// Reduction over the comparison results of float (bool) and simd vectors
+// (per-lane bit mask).
+inline bool allTrue(bool mask) { return mask; }
+template <wide::FloatVector V>
+bool allTrue(V mask) {
+  return wide::movemask(mask) == (1 << V::size) - 1;
+}
+
+// Clamps x to [min, max], sending NaN to min. The scalar version inlines,
+// unlike std::fmin and std::fmax.
+inline float clampFinite(float x, float min, float max) {
+  return std::min(max, std::max(min, x));
+}
+template <wide::FloatVector V>
+V clampFinite(V x, float min, float max) {
+  return wide::fmin(wide::fmax(x, min), max);
+}
+
+// Phase as 32 bit fixed point: INT32_MIN is -1, and a whole cycle (2) is 2^32.
+// Adding an increment is exact and wraps at the end of the cycle for free, so
+// the phase never drifts. int32_t is used for float, and simd int32 vectors
+// for float ones.
+constexpr float FIXED_PHASE_SCALE = 0x1p31f;
+
+// increment \in [0, 1), rounded to the nearest step so that the frequency
+// error is at most half a step per sample.
+inline int32_t toFixedIncrement(float increment) {
+  return static_cast<int32_t>(increment * FIXED_PHASE_SCALE + 0.5f);
+}
+template <wide::FloatVector V>
+wide::IntOf<V> toFixedIncrement(V increment) {
+  return wide::IntOf<V>(increment * FIXED_PHASE_SCALE + 0.5f);
+}
+
+inline float fromFixedPhase(int32_t phase) {
+  return static_cast<float>(phase) / FIXED_PHASE_SCALE;
+}
+template <wide::IntVector I>
+wide::FloatOf<I> fromFixedPhase(I phase) {
+  return wide::FloatOf<I>(phase) / FIXED_PHASE_SCALE;
+}
+
+// Signed overflow is undefined for int32_t, so add as uint32_t.
+inline int32_t wrappingAdd(int32_t a, int32_t b) {
+  return static_cast<int32_t>(static_cast<uint32_t>(a) +
+                              static_cast<uint32_t>(b));
+}
+template <wide::IntVector I>
+I wrappingAdd(I a, I b) {
+  return a + b;
+}
+
+// Whether (or which lanes) the phase wrapped going from previous to next.
+// Increments are below half a cycle, so only a wrap can make it go down.
+inline bool wrapped(int32_t previous, int32_t next) { return next < previous; }
+template <wide::IntVector I>
+wide::FloatOf<I> wrapped(I previous, I next) {
+  return wide::FloatOf<I>::cast(next < previous);
+}
+
+inline int32_t ifelse(bool mask, int32_t a, int32_t b) { return mask ? a : b; }
+template <wide::FloatVector Float>
+wide::IntOf<Float> ifelse(Float mask, wide::IntOf<Float> a,
+                          wide::IntOf<Float> b) {
+  return wide::IntOf<Float>::cast(
+      wide::ifelse(mask, Float::cast(a), Float::cast(b)));
+}
+
+// Moves each lane up to the next, with lane 0 cleared, for oscillators packed
+// side by side where each follows the one before.
+inline simd::float_4 nextLane(simd::float_4 x) {
+  return _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x.v), 4));
+}
+
+// Moves voices between a vector and the narrower vectors it's made of: part
+// p's lanes are lanes [p * P::size, (p + 1) * P::size) of the vector.
+template <typename V, typename P>
+void setLanes(V& vector, const P& part, int p) {
+  static_assert(sizeof(V) % sizeof(P) == 0);
+  std::memcpy(reinterpret_cast<char*>(&vector) + p * sizeof(P), &part,
+              sizeof(P));
+}
+
+template <typename V, typename P>
+void getLanes(const V& vector, P& part, int p) {
+  static_assert(sizeof(V) % sizeof(P) == 0);
+  std::memcpy(&part, reinterpret_cast<const char*>(&vector) + p * sizeof(P),
+              sizeof(P));
+}
+
+// Copies the voices of `count` narrower oscillators or decimators into the
+// lanes of a wider one of the same class, in order, for a kernel that runs
+// more voices per vector than they're stored with. Settings shared by every
+// lane are taken from them too. Each class lists its members in a static
+// visitVoices(wide, narrow, lanes, shared).
+template <typename Wide, typename Narrow>
+void gatherVoices(Wide& wide, const Narrow* parts, int count) {
+  for (int p = 0; p < count; p++) {
+    Wide::visitVoices(
+        wide, parts[p],
+        [p](auto& lanes, const auto& part) { setLanes(lanes, part, p); },
+        [](auto& setting, const auto& part) { setting = part; });
+  }
+}
+
+// Copies the voices back out after the kernel, see gatherVoices().
+template <typename Wide, typename Narrow>
+void scatterVoices(const Wide& wide, Narrow* parts, int count) {
+  for (int p = 0; p < count; p++) {
+    Wide::visitVoices(
+        wide, parts[p],
+        [p](const auto& lanes, auto& part) { getLanes(lanes, part, p); },
+        [](const auto&, auto&) {});
+  }
+}
+
+// Copies the first voice of an oscillator or decimator into one lane of
+// another, so that different oscillators of a single voice can run side by
+// side. See gatherVoices().
+template <typename T>
+void gatherLane(T& packed, const T& voices, int lane) {
+  T::visitVoices(
+      packed, voices,
+      [lane](auto& lanes, const auto& voice) { lanes[lane] = voice[0]; },
+      [](auto& setting, const auto& voice) { setting = voice; });
+}
+
+template <typename T>
+void scatterLane(const T& packed, T& voices, int lane) {
+  T::visitVoices(
+      packed, voices,
+      [lane](const auto& lanes, auto& voice) { voice[0] = lanes[lane]; },
+      [](const auto&, auto&) {});
+}
+
+// The low-pass into high-pass chain the ramp, pulse and sub go through when
+// filtering is enabled. All three share coefficients, and each stage is one
+// multiply-add per waveform: Rack's one-pole filters leave every biquad tap
+// but b0 and a0 at zero, so only those are kept.
+template <typename T>
+class WaveformFilters {
+  template <typename>
+  friend class WaveformFilters;
+
+ public:
+  using Type = typename dsp::TBiquadFilter<T>::Type;
+
+  // Takes the coefficients dsp::TBiquadFilter::setParameters() would.
+  void setParameters(Type lowPassType, float lowPassFrequency,
+                     Type highPassType, float highPassFrequency) {
+    lowPass = onePole(lowPassType, lowPassFrequency);
+    highPass = onePole(highPassType, highPassFrequency);
+  }
+
+  void reset() {
+    lowPassed = {0.f, 0.f, 0.f};
+    highPassed = {0.f, 0.f, 0.f};
+  }
+
+  // See gatherVoices().
+  template <typename Wide, typename Narrow, typename Lanes, typename Shared>
+  static void visitVoices(Wide& wide, Narrow& narrow, Lanes lanes,
+                          Shared shared) {
+    shared(wide.lowPass.b0, narrow.lowPass.b0);
+    shared(wide.lowPass.a0, narrow.lowPass.a0);
+    shared(wide.highPass.b0, narrow.highPass.b0);
+    shared(wide.highPass.a0, narrow.highPass.a0);
+    lanes(wide.lowPassed.ramp, narrow.lowPassed.ramp);
+    lanes(wide.lowPassed.pulse, narrow.lowPassed.pulse);
+    lanes(wide.lowPassed.sub, narrow.lowPassed.sub);
+    lanes(wide.highPassed.ramp, narrow.highPassed.ramp);
+    lanes(wide.highPassed.pulse, narrow.highPassed.pulse);
+    lanes(wide.highPassed.sub, narrow.highPassed.sub);
+  }
+
+  Signals<T> process(const Signals<T>& in) {
+    return {
+        step(in.ramp, lowPassed.ramp, highPassed.ramp),
+        step(in.pulse, lowPassed.pulse, highPassed.pulse),
+        step(in.sub, lowPassed.sub, highPassed.sub),
+    };
+  }
+
+  // Only steps the filters of heard waveforms, passing the rest through. The
+  // others hold their state.
+  Signals<T> process(const Signals<T>& in, const Signals<bool>& heard) {
+    return {
+        heard.ramp ? step(in.ramp, lowPassed.ramp, highPassed.ramp) : in.ramp,
+        heard.pulse ? step(in.pulse, lowPassed.pulse, highPassed.pulse)
+                    : in.pulse,
+        heard.sub ? step(in.sub, lowPassed.sub, highPassed.sub) : in.sub,
+    };
+  }
+
+ private:
+  struct OnePole {
+    float b0 = 1.f;
+    float a0 = 0.f;
+  };
+
+  OnePole lowPass;
+  OnePole highPass;
+  // Each stage's previous output.
+  Signals<T> lowPassed = {0.f, 0.f, 0.f};
+  Signals<T> highPassed = {0.f, 0.f, 0.f};
+
+  static OnePole onePole(Type type, float frequency) {
+    assert(type == Type::LOWPASS_1POLE || type == Type::HIGHPASS_1POLE);
+    dsp::TBiquadFilter<T> biquad;
+    biquad.setParameters(type, frequency, 0.f, 1.f);
+    return {biquad.b[0], biquad.a[0]};
+  }
+
+  T step(T in, T& low, T& high) {
+    low = lowPass.b0 * in - lowPass.a0 * low;
+    high = highPass.b0 * low - highPass.a0 * high;
+    return high;
+  }
+};
+
+// Frames rendered at a time, see Gemini::process().
+constexpr int BLOCK_SIZE = 32;
+
+// An oscillator's part in hard sync: the leader's wraps restart the follower.
+// PAIRED packs both into one oscillator, each leader in the lane before its
+// follower, see nextLane().
+enum class HardSync { NONE, LEADER, FOLLOWER, PAIRED };
+
+// One oscillator's state and waveforms over a slice of a block, one array per
+// value so that each pass over the slice reads and writes contiguous memory.
+// Holds BLOCK_SIZE samples: the whole block at 1x, and a slice of it when
+// oversampled, which keeps it small enough for the stack.
+template <typename T>
+struct OscillatorBlock {
+  static constexpr int MAX_SAMPLES = BLOCK_SIZE;
+
+  // Lanes that wrapped at each sample, and how long before the sample, as
+  // returned by updatePhase() and sinceWrap(). Only kept by a sync leader.
+  decltype(T() >= T()) reset[MAX_SAMPLES];
+  T sinceWrap[MAX_SAMPLES];
+  T phase[MAX_SAMPLES];
+  T increment[MAX_SAMPLES];
+  T cycle[MAX_SAMPLES];
+  T ramp[MAX_SAMPLES];
+  T pulse[MAX_SAMPLES];
+  T sub[MAX_SAMPLES];
+  // The mix of the three, before decimation.
+  T out[MAX_SAMPLES];
+};
+
+// Every array is written before it's read, so a kernel can declare one on
+// the stack without clearing it.
+static_assert(
+    std::is_trivially_default_constructible_v<OscillatorBlock<simd::float_4>>);
+
+// T is float for a single oscillator, or a simd vector such as simd::float_4
+// to run an independent voice in each lane.
+template <typename T>
+class OscillatorState {
+  template <typename>
+  friend class OscillatorState;
+
+ public:
+  // bool for float, a lane mask for simd vectors.
+  using Mask = decltype(T() >= T());
+
+ private:
+  // int32_t for float, the simd int32 vector of the same width for vectors.
+  using Fixed = decltype(toFixedIncrement(T()));
+
+  Fixed fixedPhase = INT32_MIN;  // Accumulates the phase, see wrappingAdd().
+  Fixed fixedIncrement = 0;
+  T phase = -1.f;  // fixedPhase in [-1, 1)
+  T pitch = 0.f;   // Unbounded, usually between [-10, 10]
+  const float baseFrequency;
+  float baseIncrement;  // baseFrequency per sample
+  bool filterEnabled = true;
+  T increment = 0.f;  // Advanced by each updatePhase(), as fixedIncrement.
+  // Used to determine the current cycle for the sub-pulse: 1 on even cycles,
+  // -1 on odd cycles.
+  T cycle = 1.f;
+
+  WaveformFilters<T> waveformFilters;
+  dsp::TBiquadFilter<T> lowPassMix;
+
+  static constexpr float FILTER_Q = 0.7f;
+  static constexpr float FILTER_V = 1.f;
+
+  // Avoids dividing by zero when finding edges of a stopped oscillator.
+  static constexpr float MIN_INCREMENT = 1e-6f;
+  // The phase spans 2 per cycle, so this is just below Nyquist. Capping the
+  // increment to it keeps each fixed point increment below half a cycle.
+  static constexpr float MAX_INCREMENT = 0x1.fffffep-1f;
+  // Well past any useful pitch; keeps the frequency finite for any CV.
+  static constexpr float MAX_PITCH = 12.f;
+
+  using Filter = dsp::TBiquadFilter<T>;
+
+  // Lanes of T, 1 for float.
+  static constexpr int LANES = [] {
+    if constexpr (std::is_same_v<T, float>) {
+      return 1;
+    } else {
+      return T::size;
+    }
+  }();
+
+  // Lane i of a fixed point value, as the unsigned steps it advances by.
+  static uint32_t fixedLane(const Fixed& x, int i) {
+    if constexpr (std::is_same_v<T, float>) {
+      return x;
+    } else {
+      return x[i];
+    }
+  }
+
+  // Advances one fixed point phase by `steps`, a sum of increments. Returns
+  // whether it wrapped an odd number of times.
+  static bool skipPhase(int32_t& fixedPhase, uint64_t steps) {
+    // Counting from -1, each carry out of 32 bits is a wrap.
+    const uint64_t end =
+        (static_cast<uint32_t>(fixedPhase) ^ 0x80000000u) + steps;
+    fixedPhase = static_cast<uint32_t>(end) ^ 0x80000000u;
+    return (end >> 32) & 1;
+  }
+
+ public:
+  OscillatorState(float startingFrequency = rack::dsp::FREQ_C4)
+      : baseFrequency(startingFrequency) {
+    updateSampleRate(48000.f);
+  }
+
+  void updateSampleRate(float sampleRate) {
+    float halfIsh = (sampleRate - 0.01f) / 2.f;
+    waveformFilters.setParameters(Filter::Type::LOWPASS_1POLE, halfIsh,
+                                  Filter::Type::HIGHPASS_1POLE,
+                                  FILTER_Q / sampleRate);
+
+    lowPassMix.setParameters(Filter::Type::LOWPASS_1POLE, halfIsh, FILTER_Q,
+                             FILTER_V);
+
+    baseIncrement = baseFrequency / sampleRate;
+    updateFrequency();
+  }
+
+  void resetFilters() {
+    waveformFilters.reset();
+    lowPassMix.reset();
+  }
+
+  // See gatherVoices(). Oscillators are only gathered with others of the same
+  // base frequency.
+  template <typename Wide, typename Narrow, typename Lanes, typename Shared>
+  static void visitVoices(Wide& wide, Narrow& narrow, Lanes lanes,
+                          Shared shared) {
+    lanes(wide.fixedPhase, narrow.fixedPhase);
+    lanes(wide.fixedIncrement, narrow.fixedIncrement);
+    lanes(wide.phase, narrow.phase);
+    lanes(wide.pitch, narrow.pitch);
+    lanes(wide.increment, narrow.increment);
+    lanes(wide.cycle, narrow.cycle);
+    shared(wide.baseIncrement, narrow.baseIncrement);
+    shared(wide.filterEnabled, narrow.filterEnabled);
+    WaveformFilters<T>::visitVoices(wide.waveformFilters,
+                                    narrow.waveformFilters, lanes, shared);
+    for (int i = 0; i < 2; i++) {
+      lanes(wide.lowPassMix.x[i], narrow.lowPassMix.x[i]);
+      lanes(wide.lowPassMix.y[i], narrow.lowPassMix.y[i]);
+      shared(wide.lowPassMix.a[i], narrow.lowPassMix.a[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+      shared(wide.lowPassMix.b[i], narrow.lowPassMix.b[i]);
+    }
+  }
+  // Advances each lane by its steps at once.
+  void skipPhase(const uint64_t* steps) {
+    if constexpr (std::is_same_v<T, float>) {
+      cycle = skipPhase(fixedPhase, steps[0]) ? -cycle : cycle;
+    } else {
+      for (int i = 0; i < T::size; i++) {
+        if (skipPhase(fixedPhase[i], steps[i])) {
+          cycle[i] = -cycle[i];
+        }
+      }
+    }
+    phase = fromFixedPhase(fixedPhase);
+  }
+
+  // Advances by `samples` at once at the current pitch.
+  void skipPhase(int samples) {
+    uint64_t steps[LANES];
+    for (int i = 0; i < LANES; i++) {
+      steps[i] = static_cast<uint64_t>(samples) * fixedLane(fixedIncrement, i);
+    }
+    skipPhase(steps);
+  }
+
+  // For hard sync, restarts the lanes set in the mask as of `elapsed`
+  // samples ago, so they keep the phase advanced since.
+  void syncPhase(Mask sync, T elapsed) {
+    const Fixed restarted =
+        Fixed(INT32_MIN) + toFixedIncrement(elapsed * increment);
+    fixedPhase = ifelse(sync, restarted, fixedPhase);
+    phase = fromFixedPhase(fixedPhase);
+    cycle = wide::ifelse(sync, 1.f, cycle);
+  }
+
+  // Moves each lane to a phase in [-1, 1), with its sub on the given cycle (1
+  // or -1), so that oscillators can start out of step with each other.
+  void setPhase(T phase, T cycle) {
+    fixedPhase = toFixedIncrement(phase);
+    this->phase = fromFixedPhase(fixedPhase);
+    this->cycle = cycle;
+  }
+
+  // Advances by one sample at the rate last passed to updateSampleRate().
+  // Returns which lanes (or, for float, whether) a reset occurred.
+  Mask updatePhase() {
+    const Fixed previous = fixedPhase;
+    fixedPhase = wrappingAdd(fixedPhase, fixedIncrement);
+    phase = fromFixedPhase(fixedPhase);
+    Mask reset = wrapped(previous, fixedPhase);
+    cycle = wide::ifelse(reset, -cycle, cycle);
+    return reset;
+  }
+
+  // In the sample a lane wraps, how far into the sample the wrap was, in
+  // [0, 1), exact to the fixed point phase.
+  T sinceWrap() {
+    const Fixed elapsed = wrappingAdd(fixedPhase, Fixed(INT32_MIN));
+    return fromFixedPhase(elapsed) /
+           wide::fmax(fromFixedPhase(fixedIncrement), MIN_INCREMENT);
+  }
+
+  void updatePitch(T pitch) {
+    if (allTrue(this->pitch == pitch)) {
+      return;
+    }
+    this->pitch = pitch;
+    updateFrequency();
+  }
+
+  // NaN and infinite pitches are clamped like any other, so the frequency is
+  // always finite and below Nyquist. The increment is worked out here rather
+  // than per sample.
+  void updateFrequency() {
+    const T pitch = clampFinite(this->pitch, -MAX_PITCH, MAX_PITCH);
+    increment =
+        clampFinite(baseIncrement * fastExp2(pitch), 0.f, MAX_INCREMENT);
+    fixedIncrement = toFixedIncrement(increment);
+  }
+
+  void enableFilter(bool filterEnabled) {
+    if (filterEnabled != this->filterEnabled) {
+      this->filterEnabled = filterEnabled;
+      this->resetFilters();
+    }
+  }
+
+  T triangle() { return triangle(phase); }
+
+  template <typename V>
+  static V triangle(V phase) {  // phase \in [-1, 1)
+    V triangle = phase + 1.f;
+    triangle = wide::ifelse(triangle > 1.f, 1.f - (triangle - 1.f),
+                            triangle);  // triangle \in [0, 1)
+    triangle *= 2.f;                    // triangle \in [0, 2)
+    return triangle - 1.f;              // result in [-1, 1)
+  }
+
+  // Advances a single control rate oscillator by `frames` samples, a multiple
+  // of four, filling out with its triangle times depth at each. The pitch is
+  // held across them, so stepping the phase linearly from the start of the
+  // block matches updatePhase() exactly, corners and all.
+  void advanceTriangle(float* out, int frames, float depth) {
+    static_assert(std::is_same_v<T, float>);
+    const uint32_t start = fixedPhase;
+    const uint32_t step = fixedIncrement;
+    simd::int32_4 fixed(start + step, start + 2 * step, start + 3 * step,
+                        start + 4 * step);
+    const simd::int32_4 stride = int32_t(4 * step);
+    for (int f = 0; f < frames; f += 4) {
+      (triangle(fromFixedPhase(fixed)) * depth).store(&out[f]);
+      fixed = wrappingAdd(fixed, stride);
+    }
+    skipPhase(frames);
+  }
+
+  // Distance, in samples, to the nearest phase wrap. Negative before the wrap.
+  static T wrapDistance(T phase, T increment) {
+    return wide::ifelse(phase < 0.f, phase + 1.f, phase - 1.f) /
+           wide::fmax(increment, MIN_INCREMENT);
+  }
+
+  template <bool FILTER, bool BAND_LIMITED>
+  static T ramp(T phase, T increment) {  // phase \in [-1, 1)
+    if constexpr (FILTER && BAND_LIMITED) {
+      return rampMipmapValue(phase, increment);
+    } else if constexpr (FILTER) {
+      return rampWavetableValue(phase);
+    } else if constexpr (BAND_LIMITED) {
+      // Jumps from -1 to 1 at the wrap.
+      return -phase + 2.f * polyBlep(wrapDistance(phase, increment));
+    } else {
+      return -phase;
+    }
+  }
+
+  // Shift the phase to make it match gemini.wntr.dev diagrams.
+  template <bool FILTER, bool BAND_LIMITED>
+  static T sub(T phase, T increment, T cycle) {  // phase \in [-1, 1)
+    T value;
+    if constexpr (FILTER) {
+      // Apply a slight linear decrease, proportional to the phase.
+      T offset = 1.f - ((1.f + phase) / 10.f);
+      value = cycle * offset;
+    } else {
+      value = cycle;
+    }
+    if constexpr (BAND_LIMITED) {
+      // The cycle flips at the wrap, so before the wrap the step is away from
+      // the current cycle, and after it towards it.
+      T t = wrapDistance(phase, increment);
+      T previousCycle = wide::ifelse(t < 0.f, cycle, -cycle);
+      if constexpr (FILTER) {
+        // From 0.8 to -1 (times the cycle), with the slope changing sign.
+        value += -1.8f * previousCycle * polyBlep(t);
+        value += 0.2f * previousCycle * increment * polyBlamp(t);
+      } else {
+        value += -2.f * previousCycle * polyBlep(t);
+      }
+    }
+    return value;
+  }
+
+  // phase \in [-1, 1), duty in [0, 1)
+  template <bool BAND_LIMITED>
+  static T pulse(T phase, T increment, T duty) {
+    T normal = (phase + 1.f) / 2.f;
+    T value = wide::ifelse(normal > duty, -1.f, 1.f);
+    if constexpr (BAND_LIMITED) {
+      // Falls from 1 to -1 when the phase passes the duty cycle, and rises
+      // back at the wrap. Pulses outside of (0, 1) are constant.
+      T fall = phase - (2.f * duty - 1.f);
+      fall -= 2.f * wide::floor((fall + 1.f) / 2.f);  // in [-1, 1)
+      T correction =
+          2.f * polyBlep(wrapDistance(phase, increment)) -
+          2.f * polyBlep(fall / wide::fmax(increment, MIN_INCREMENT));
+      value += wide::ifelse((duty > 0.f) & (duty < 1.f), correction, 0.f);
+    }
+    return value;
+  }
+
+  // FILTER must match the value last passed to enableFilter().
+  // BAND_LIMITED applies PolyBLEP (and PolyBLAMP) corrections around each
+  // discontinuity, or reads the ramp from its mipmap.
+  template <bool FILTER, bool BAND_LIMITED>
+  Signals<T> getSignals(T duty, float offset) {
+    const Signals<T> signals = {
+        ramp<FILTER, BAND_LIMITED>(phase, increment),
+        pulse<BAND_LIMITED>(phase, increment, duty),
+        sub<FILTER, BAND_LIMITED>(phase, increment, cycle),
+    };
+    if constexpr (FILTER) {
+      return waveformFilters.process(signals);
+    }
+    return signals;
+  }
+
+  // A is float, or T for levels that differ per lane.
+  template <bool FILTER, typename A>
+  T getOutput(const Signals<T>& wave, const Signals<A>& amplitude) {
+    const T mix = 5.f *
+                  (wave.ramp * amplitude.ramp + wave.pulse * amplitude.pulse +
+                   wave.sub * amplitude.sub) /
+                  3.f;
+    if constexpr (FILTER) {
+      return lowPassMix.process(mix);
+    }
+    return mix;
+  }
+
+  // Renders a slice of a block in passes over an OscillatorBlock: advance()
+  // runs the phase, then render() the waveforms, filters and mix. Each frame
+  // is `oversampling` samples, with the pitch and duty held across them.
+
+  // A sync leader keeps its wraps in the block, which a follower then reads
+  // from the leader's block.
+  template <HardSync SYNC>
+  void advance(OscillatorBlock<T>& block, const T* pitch, int frames,
+               int oversampling,
+               const OscillatorBlock<T>* leader = nullptr) {
+    for (int f = 0, s = 0; f < frames; f++) {
+      updatePitch(pitch[f]);
+      for (int i = 0; i < oversampling; i++, s++) {
+        const Mask reset = updatePhase();
+        if constexpr (SYNC == HardSync::LEADER) {
+          block.reset[s] = reset;
+          block.sinceWrap[s] = sinceWrap();
+        } else if constexpr (SYNC == HardSync::FOLLOWER) {
+          syncPhase(leader->reset[s], leader->sinceWrap[s]);
+        } else if constexpr (SYNC == HardSync::PAIRED) {
+          syncPhase(nextLane(reset), nextLane(sinceWrap()));
+        }
+        block.phase[s] = phase;
+        block.increment[s] = increment;
+        block.cycle[s] = cycle;
+      }
+    }
+  }
+
+  // Takes the place of advance() for an oscillator that isn't heard. The
+  // phase moves on by the sum of each frame's increments, without stepping
+  // through the samples, so it lands exactly where advance() would have left
+  // it, however the pitch was modulated.
+  void skip(const T* pitch, int frames, int oversampling) {
+    uint64_t steps[LANES] = {};
+    for (int f = 0; f < frames; f++) {
+      updatePitch(pitch[f]);
+      for (int i = 0; i < LANES; i++) {
+        steps[i] += fixedLane(fixedIncrement, i);
+      }
+    }
+    for (int i = 0; i < LANES; i++) {
+      steps[i] *= oversampling;
+    }
+    skipPhase(steps);
+  }
+
+  // The levels ramp linearly from `from` to `to` across the block. Waveforms
+  // at zero level throughout, in every lane, are neither generated nor
+  // filtered.
+  template <bool FILTER, bool BAND_LIMITED, typename A>
+  void render(OscillatorBlock<T>& block, const T* duty, int frames,
+              int oversampling, const Signals<A>& from, const Signals<A>& to) {
+    const Signals<bool> heard = isHeard(from, to);
+    // No sample depends on another until the filters.
+    for (int f = 0, s = 0; f < frames; f++) {
+      for (int i = 0; i < oversampling; i++, s++) {
+        block.ramp[s] = heard.ramp ? ramp<FILTER, BAND_LIMITED>(
+                                         block.phase[s], block.increment[s])
+                                   : 0.f;
+        block.pulse[s] = heard.pulse
+                             ? pulse<BAND_LIMITED>(block.phase[s],
+                                                   block.increment[s], duty[f])
+                             : 0.f;
+        block.sub[s] = heard.sub ? sub<FILTER, BAND_LIMITED>(
+                                       block.phase[s], block.increment[s],
+                                       block.cycle[s])
+                                 : 0.f;
+      }
+    }
+    const int samples = frames * oversampling;
+    const bool allHeard = heard.ramp && heard.pulse && heard.sub;
+    // How much the levels move per sample.
+    const float slope = 1.f / samples;
+    const Signals<A> change = {(to.ramp - from.ramp) * slope,
+                               (to.pulse - from.pulse) * slope,
+                               (to.sub - from.sub) * slope};
+    // Whether any level changes, in any lane.
+    const bool moving = anyHeard(isHeard(change));
+    for (int s = 0; s < samples; s++) {
+      Signals<T> signals = {block.ramp[s], block.pulse[s], block.sub[s]};
+      if constexpr (FILTER) {
+        signals = allHeard ? waveformFilters.process(signals)
+                           : waveformFilters.process(signals, heard);
+      }
+      Signals<A> amplitude = to;
+      if (moving) {
+        const float t = s + 1;
+        amplitude = {from.ramp + change.ramp * t, from.pulse + change.pulse * t,
+                     from.sub + change.sub * t};
+      }
+      block.out[s] = getOutput<FILTER>(signals, amplitude);
+    }
+  }
+};
+
+// Follows a knob at a limited rate, one step per block, so that moving it
+// doesn't step the audio. Unlike a one-pole it arrives exactly, which lets a
+// level that's turned down be skipped once it gets there.
+class ParamSlew {
+ public:
+  // Moves towards target by at most maxStep.
+  void step(float target, float maxStep) {
+    from = to;
+    to += clampFinite(target - to, -maxStep, maxStep);
+  }
+
+  float from = 0.f;  // At the start of the block
+  float to = 0.f;    // At its end
+
+  // Interpolated linearly, for t \in [0, 1] through the block.
+  float at(float t) const { return from + (to - from) * t; }
+
+  // Jumps to value, for a knob with nothing to move from.
+  void reset(float value) { from = to = value; }
+};
+
+// The levels t \in [0, 1] of the way through a block in which they move from
+// `from` to `to`, arriving exactly.
+template <typename A>
+Signals<A> levelsAt(const Signals<A>& from, const Signals<A>& to, float t) {
+  if (t == 1.f) {
+    return to;
+  }
+  return {from.ramp + (to.ramp - from.ramp) * t,
+          from.pulse + (to.pulse - from.pulse) * t,
+          from.sub + (to.sub - from.sub) * t};
+}
+
+// The levels at the start and end of the block.
+inline Signals<float> levelsFrom(const Signals<ParamSlew>& levels) {
+  return {levels.ramp.from, levels.pulse.from, levels.sub.from};
+}
+
+inline Signals<float> levelsTo(const Signals<ParamSlew>& levels) {
+  return {levels.ramp.to, levels.pulse.to, levels.sub.to};
+}
+
+struct Gemini : Module {
+  enum ParamId {
+    CASTOR_PITCH_PARAM,
+    POLLUX_PITCH_PARAM,
+    LFO_PARAM,
+    CASTOR_DUTY_PARAM,
+    POLLUX_DUTY_PARAM,
+    CROSSFADE_PARAM,
+    CASTOR_RAMP_LEVEL_PARAM,
+    CASTOR_PULSE_LEVEL_PARAM,
+    POLLUX_PULSE_LEVEL_PARAM,
+    BUTTON_PARAM,
+    CASTOR_SUB_LEVEL_PARAM,
+    POLLUX_SUB_LEVEL_PARAM,
+    POLLUX_RAMP_LEVEL_PARAM,
+    ALT_MODE_BUTTON_PARAM,
+    FILTER_ENABLE_BUTTON_PARAM,
+    PARAMS_LEN
+  };
+  enum InputId {
+    CASTOR_DUTY_INPUT,
+    POLLUX_DUTY_INPUT,
+    CASTOR_PITCH_INPUT,
+    POLLUX_PITCH_INPUT,
+    INPUTS_LEN
+  };
+  enum OutputId {
+    CASTOR_MIX_OUTPUT,
+    MIX_OUTPUT,
+    POLLUX_MIX_OUTPUT,
+    OUTPUTS_LEN
+  };
+  enum LightId { LIGHTS_LEN };
+
+  enum Mode {
+    CHORUS,
+    LFO_PWM,
+    LFO_FM,
+    HARD_SYNC,
+  };
+
+  static constexpr int MODES_LEN = 4;
+
+  // Every distinct stored param value. Most params share one value across all
+  // modes, the others have a separate value for some modes. Patches store the
+  // bank in this order, so new slots go at the end.
+  enum ParamSlot : uint8_t {
+    CASTOR_PITCH_SLOT,
+    POLLUX_PITCH_SLOT,
+    POLLUX_PITCH_MULTIPLIER_SLOT,
+    CASTOR_DUTY_SLOT,
+    POLLUX_DUTY_SLOT,
+    LFO_PWM_CASTOR_PULSE_WIDTH_CENTRE_SLOT,
+    LFO_PWM_POLLUX_PULSE_WIDTH_CENTRE_SLOT,
+    CROSSFADE_SLOT,
+    CASTOR_RAMP_LEVEL_SLOT,
+    CASTOR_PULSE_LEVEL_SLOT,
+    CASTOR_SUB_LEVEL_SLOT,
+    POLLUX_RAMP_LEVEL_SLOT,
+    POLLUX_PULSE_LEVEL_SLOT,
+    POLLUX_SUB_LEVEL_SLOT,
+    BUTTON_SLOT,
+    ALT_MODE_BUTTON_SLOT,
+    LFO_AMPLITUDE_SLOT,
+    LFO_CHORUS_FREQ_SLOT,
+    LFO_PWM_FREQ_SLOT,
+    LFO_FM_FREQ_SLOT,
+    LFO_HARD_SYNC_FREQ_SLOT,
+    FILTER_ENABLE_SLOT,
+    SLOTS_LEN
+  };
+
+  // A value for each slot.
+  using ParamBank = std::array<float, SLOTS_LEN>;
+
+  static constexpr ParamBank DEFAULT_PARAM_BANK = [] {
+    ParamBank bank{};
+    bank[CROSSFADE_SLOT] = 0.5f;
+    bank[POLLUX_PITCH_MULTIPLIER_SLOT] = -1.f;
+    bank[FILTER_ENABLE_SLOT] = 1.f;
+    return bank;
+  }();
+
+  using ParamSlotTable = std::array<
+      std::array<std::array<ParamSlot, PARAMS_LEN>, MODES_LEN>, 2>;
+
+  // Maps [altMode][Mode][ParamId] to the slot in paramBank holding its value.
+  static constexpr ParamSlotTable PARAM_SLOTS = [] {
+    auto slot = [](bool altMode, Mode lfoMode, ParamId param) {
+      switch (param) {
+        case CASTOR_PITCH_PARAM:
+          return CASTOR_PITCH_SLOT;
+        case POLLUX_PITCH_PARAM:
+          return lfoMode == HARD_SYNC ? POLLUX_PITCH_MULTIPLIER_SLOT
+                                      : POLLUX_PITCH_SLOT;
+        case CASTOR_RAMP_LEVEL_PARAM:
+          return CASTOR_RAMP_LEVEL_SLOT;
+        case CASTOR_PULSE_LEVEL_PARAM:
+          return CASTOR_PULSE_LEVEL_SLOT;
+        case POLLUX_PULSE_LEVEL_PARAM:
+          return POLLUX_PULSE_LEVEL_SLOT;
+        case BUTTON_PARAM:
+          return BUTTON_SLOT;
+        case CASTOR_SUB_LEVEL_PARAM:
+          return CASTOR_SUB_LEVEL_SLOT;
+        case POLLUX_SUB_LEVEL_PARAM:
+          return POLLUX_SUB_LEVEL_SLOT;
+        case POLLUX_RAMP_LEVEL_PARAM:
+          return POLLUX_RAMP_LEVEL_SLOT;
+        case ALT_MODE_BUTTON_PARAM:
+          return ALT_MODE_BUTTON_SLOT;
+        case CROSSFADE_PARAM:
+          return CROSSFADE_SLOT;
+        case CASTOR_DUTY_PARAM:
+          return lfoMode == LFO_PWM && altMode
+                     ? LFO_PWM_CASTOR_PULSE_WIDTH_CENTRE_SLOT
+                     : CASTOR_DUTY_SLOT;
+        case POLLUX_DUTY_PARAM:
+          return lfoMode == LFO_PWM && altMode
+                     ? LFO_PWM_POLLUX_PULSE_WIDTH_CENTRE_SLOT
+                     : POLLUX_DUTY_SLOT;
+        case LFO_PARAM:
+          switch (lfoMode) {
+            case CHORUS:
+              return altMode ? LFO_AMPLITUDE_SLOT : LFO_CHORUS_FREQ_SLOT;
+            case LFO_PWM:
+              return LFO_PWM_FREQ_SLOT;
+            case LFO_FM:
+              return LFO_FM_FREQ_SLOT;
+            case HARD_SYNC:
+              return LFO_HARD_SYNC_FREQ_SLOT;
+          }
+          break;
+        case FILTER_ENABLE_BUTTON_PARAM:
+          return FILTER_ENABLE_SLOT;
+        case PARAMS_LEN:
+          break;
+      }
+      return SLOTS_LEN;
+    };
+
+    ParamSlotTable table{};
+    for (int altMode = 0; altMode < 2; ++altMode) {
+      for (int mode = 0; mode < MODES_LEN; ++mode) {
+        for (int param = 0; param < PARAMS_LEN; ++param) {
+          table[altMode][mode][param] =
+              slot(altMode, static_cast<Mode>(mode), static_cast<ParamId>(param));
+        }
+      }
+    }
+    return table;
+  }();
+
+  // The range of each param's knob or switch.
+  struct ParamRange {
+    float min;
+    float max;
+
+    constexpr float size() const { return max - min; }
+  };
+
+  static constexpr std::array<ParamRange, PARAMS_LEN> PARAM_RANGES = [] {
+    std::array<ParamRange, PARAMS_LEN> ranges{};
+    ranges.fill({0.f, 1.f});
+    ranges[CASTOR_PITCH_PARAM] = {-1.f, 1.f};
+    ranges[POLLUX_PITCH_PARAM] = {-1.f, 1.f};
+    ranges[BUTTON_PARAM] = {0.f, MODES_LEN - 1.f};
+    return ranges;
+  }();
+
+  // A param stored in each slot, whose range its value is kept in.
+  static constexpr std::array<ParamId, SLOTS_LEN> SLOT_PARAMS = [] {
+    std::array<ParamId, SLOTS_LEN> params{};
+    for (const auto& slotsForAltMode : PARAM_SLOTS) {
+      for (const auto& slots : slotsForAltMode) {
+        for (int param = 0; param < PARAMS_LEN; ++param) {
+          params[slots[param]] = static_cast<ParamId>(param);
+        }
+      }
+    }
+    return params;
+  }();
+
+  // Patches from before versioning store each [altMode][Mode][ParamId] under
+  // its own "param/mode/altMode" key. Version 1 stores paramBank as an array.
+  static constexpr int PATCH_VERSION = 1;
+
+  Mode mode = CHORUS;
+  bool altMode = false;
+
+  // Polyphony follows the pitch inputs, up to 16 voices in groups of four.
+  static constexpr int MAX_CHANNELS = 16;
+  static constexpr int MAX_GROUPS = MAX_CHANNELS / 4;
+  static constexpr int MAX_OVERSAMPLING =
+      Decimator<simd::float_4>::MAX_OVERSAMPLING;
+  // Seconds for a smoothed knob to follow a full-scale move.
+  static constexpr float SLEW_TIME = 0.005f;
+  // Copies of a voice in unison take a lane each, so each voice can have as
+  // many as there are lanes, and the voices share the lanes between them.
+  static constexpr int MAX_UNISON = MAX_CHANNELS;
+  static constexpr std::array<float, 5> UNISON_DETUNES = {5.f, 10.f, 20.f,
+                                                          35.f, 50.f};
+
+  // Everything the kernels derive from the knobs, worked out once by
+  // updateParams() whenever they change, so that a block only reads the
+  // block's captured inputs and this.
+  struct KnobCv {
+    // Castor's pitch when its input is unpatched, see quantizedKnobPitch().
+    float castorPitch;
+    // Added to the pitch inputs when they're patched.
+    float castorOffset;
+    float polluxOffset;
+    // Pollux's pitch above its base in hard sync, see hardSyncRatio().
+    float syncRatio;
+    // The LFO's pitch, and the depth of its triangle.
+    float lfoCv;
+    float lfoDepth;
+  };
+
+  // Audio thread state, from here to the gathered voices, is kept together in
+  // a run of cache lines inside the instance, so that rendering touches as
+  // little memory as it can and nothing is allocated. UI state comes after
+  // it.
+
+  // Param Values - updated by user, can be slightly stale.
+  alignas(64) ParamBank paramBank = DEFAULT_PARAM_BANK;
+
+  OscillatorState<simd::float_4> castor[MAX_GROUPS];
+  OscillatorState<simd::float_4> pollux[MAX_GROUPS];
+  Decimator<simd::float_4> castorDecimator[MAX_GROUPS];
+  Decimator<simd::float_4> polluxDecimator[MAX_GROUPS];
+  // The LFO isn't voltage controlled, so is shared by all voices.
+  OscillatorState<float> lfo = OscillatorState<float>(2.f);
+  // What the kernels read of the knobs, see KnobCv.
+  KnobCv knobCv = knobCvFor(DEFAULT_PARAM_BANK, CHORUS, false);
+  // The knobs whose steps would be heard, as they move towards paramBank.
+  Signals<ParamSlew> castorLevelSlew;
+  Signals<ParamSlew> polluxLevelSlew;
+  ParamSlew crossfadeSlew;
+  ParamSlew castorDutySlew;
+  ParamSlew polluxDutySlew;
+  // How far those move per block, per unit of their range, see
+  // slewStepOf().
+  float slewStep = 1.f;
+  // Each lane's pitch offset from its voice in unison, see renderUnison().
+  simd::float_4 unisonPitch[MAX_GROUPS] = {};
+  // The params as of the last updateParams(), see paramsChanged().
+  std::array<float, PARAMS_LEN> seenParams{};
+  // Whether each oscillator was heard at a connected output in the last
+  // block, see processKernel().
+  bool castorHeard = false;
+  bool polluxHeard = false;
+  int blockPosition = 0;
+
+  // Instruction sets with wider kernels than SSE's simd::float_4, see
+  // renderVoicesAvx2().
+  enum class Isa { SSE, AVX2, AVX512 };
+
+  // The widest the CPU runs, from CPUID, which checks the OS saves the wider
+  // registers too.
+  static Isa supportedIsa() {
+#ifdef GEMINI_WIDE_KERNELS
+    if (__builtin_cpu_supports("avx512f")) {
+      return Isa::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+      return Isa::AVX2;
+    }
+#endif
+    return Isa::SSE;
+  }
+
+  // The widest kernels this instance may use. Can be lowered, never raised.
+  Isa isa = supportedIsa();
+
+  struct alignas(64) Block {
+    bool connected[INPUTS_LEN][BLOCK_SIZE];
+    int channels[BLOCK_SIZE];
+    // The shared LFO, already scaled for the mode.
+    float lfo[BLOCK_SIZE];
+    int outChannels[BLOCK_SIZE];
+  };
+
+  Block block{};
+
+  // A block's voltages for a group of four voices, see groupBlocks.
+  struct alignas(64) GroupBlock {
+    // Inputs, per input and frame. Only captured while the input is
+    // connected, so are stale otherwise.
+    simd::float_4 cv[INPUTS_LEN][BLOCK_SIZE];
+    // Outputs, per output and frame.
+    simd::float_4 out[OUTPUTS_LEN][BLOCK_SIZE];
+  };
+
+  // Per group, so that a patch only touches the groups it has channels for.
+  // Groups above a frame's channel count are left as they were, as their
+  // output isn't played for that frame.
+  GroupBlock groupBlocks[MAX_GROUPS] = {};
+
+  // A single voice's Castor and Pollux, side by side in the lanes of one
+  // oscillator so that each step runs both at once, see renderPair(). The
+  // other two lanes are spare.
+  static constexpr int CASTOR_LANE = 0;
+  static constexpr int POLLUX_LANE = 1;
+  // Pollux follows in the next lane, see HardSync::PAIRED.
+  static_assert(POLLUX_LANE == CASTOR_LANE + 1);
+
+  struct alignas(64) Pair {
+    OscillatorState<simd::float_4> oscillators;
+    Decimator<simd::float_4> decimator;
+  };
+
+  Pair pair;
+
+  // The voices of the groups a wide kernel renders, gathered for the block,
+  // see renderVoices(). The working space the kernels render into is on the
+  // stack, see OscillatorBlock.
+  template <typename V>
+  struct alignas(64) Voices {
+    OscillatorState<V> castor;
+    OscillatorState<V> pollux;
+    Decimator<V> castorDecimator;
+    Decimator<V> polluxDecimator;
+  };
+
+#ifdef GEMINI_WIDE_KERNELS
+  // Last, as they're only touched on CPUs that run the wider kernels.
+  Voices<wide::float_8> voices8;
+  Voices<wide::float_16> voices16;
+
+  template <typename V>
+  Voices<V>& gathered() {
+    if constexpr (std::is_same_v<V, wide::float_8>) {
+      return voices8;
+    } else {
+      return voices16;
+    }
+  }
+#endif
+
+  using LabelParams = std::array<ReplaceableLabelParamQuantity*, PARAMS_LEN>;
+  LabelParams labelParams;
+
+  Gemini() {
+    config(PARAMS_LEN, INPUTS_LEN, OUTPUTS_LEN, LIGHTS_LEN);
+    configControls(this, labelParams);
+    this->refreshLabels();
+
+    // Build the ramp mipmap now, rather than on the audio thread.
+    rampMipmap();
+    std::fill(std::begin(block.outChannels), std::end(block.outChannels), 1);
+  }
+
+  // Configures Gemini's params and ports on a module whose ids start with
+  // Gemini's, so that GeminiBank can share them.
+  static void configControls(Module* module, LabelParams& labelParams) {
+    // The labels change with the mode, see refreshLabels().
+    auto configLabelParam = [&](ParamId param, float defaultValue,
+                                std::string name) {
+      labelParams[param] =
+          module->configParam<ReplaceableLabelParamQuantity>(
+              param, PARAM_RANGES[param].min, PARAM_RANGES[param].max,
+              defaultValue, name);
+    };
+    configLabelParam(CASTOR_PITCH_PARAM, 0.f, "Castor pitch");
+    configLabelParam(POLLUX_PITCH_PARAM, 0.f, "Pollux pitch");
+    configLabelParam(LFO_PARAM, 0.f, "LFO");
+    configLabelParam(CASTOR_DUTY_PARAM, 0.f, "Castor duty");
+    configLabelParam(POLLUX_DUTY_PARAM, 0.f, "Pollux duty");
+    configLabelParam(CROSSFADE_PARAM, 0.5f, "Crossfade");
+    configLabelParam(CASTOR_RAMP_LEVEL_PARAM, 0.f, "Castor ramp level");
+    configLabelParam(CASTOR_PULSE_LEVEL_PARAM, 0.f, "Castor pulse level");
+    configLabelParam(POLLUX_PULSE_LEVEL_PARAM, 0.f, "Pollux pulse level");
+    configLabelParam(BUTTON_PARAM, 0.f, "Mode switch");
+    configLabelParam(CASTOR_SUB_LEVEL_PARAM, 0.f, "Castor sub level");
+    configLabelParam(POLLUX_SUB_LEVEL_PARAM, 0.f, "Pollux sub level");
+    configLabelParam(POLLUX_RAMP_LEVEL_PARAM, 0.f, "Pollux ramp level");
+    configLabelParam(ALT_MODE_BUTTON_PARAM, 0.f, "Alt Mode switch");
+    configLabelParam(FILTER_ENABLE_BUTTON_PARAM, 1.f,
+                     "Enable filtering switch");
+
+    module->configInput(CASTOR_DUTY_INPUT, "Castor duty");
+    module->configInput(POLLUX_DUTY_INPUT, "Pollux duty");
+    module->configInput(CASTOR_PITCH_INPUT, "Castor pitch");
+    module->configInput(POLLUX_PITCH_INPUT, "Pollux pitch");
+
+    module->configOutput(CASTOR_MIX_OUTPUT, "Castor");
+    module->configOutput(MIX_OUTPUT, "Mix");
+    module->configOutput(POLLUX_MIX_OUTPUT, "Pollux");
+  }
+
+  json_t* dataToJson() override {
+    json_t* rootJ = json_object();
+    json_object_set_new(rootJ, "version", json_integer(PATCH_VERSION));
+    json_t* paramBankJ = json_array();
+    for (float value : paramBank) {
+      json_array_append_new(paramBankJ, json_real(value));
+    }
+    json_object_set_new(rootJ, "paramBank", paramBankJ);
+    json_object_set_new(
+        rootJ, "bandLimited",
+        json_boolean(bandLimited.load(std::memory_order_relaxed)));
+    json_object_set_new(
+        rootJ, "oversampling",
+        json_integer(oversampling.load(std::memory_order_relaxed)));
+    json_object_set_new(rootJ, "unison",
+                        json_integer(unison.load(std::memory_order_relaxed)));
+    json_object_set_new(
+        rootJ, "unisonDetune",
+        json_real(unisonDetune.load(std::memory_order_relaxed)));
+    return rootJ;
+  }
+
+  void dataFromJson(json_t* rootJ) override {
+    if (json_t* bandLimitedJ = json_object_get(rootJ, "bandLimited")) {
+      bandLimited.store(json_boolean_value(bandLimitedJ),
+                        std::memory_order_relaxed);
+    }
+    if (json_t* oversamplingJ = json_object_get(rootJ, "oversampling")) {
+      int value = json_integer_value(oversamplingJ);
+      if (value == 1 || value == 2 || value == 4 || value == 8) {
+        oversampling.store(value, std::memory_order_relaxed);
+      }
+    }
+    if (json_t* unisonJ = json_object_get(rootJ, "unison")) {
+      unison.store(math::clamp(static_cast<int>(json_integer_value(unisonJ)),
+                               1, MAX_UNISON),
+                   std::memory_order_relaxed);
+    }
+    if (json_t* unisonDetuneJ = json_object_get(rootJ, "unisonDetune")) {
+      const float value = json_number_value(unisonDetuneJ);
+      if (std::find(UNISON_DETUNES.begin(), UNISON_DETUNES.end(), value) !=
+          UNISON_DETUNES.end()) {
+        unisonDetune.store(value, std::memory_order_relaxed);
+      }
+    }
+
+    if (json_integer_value(json_object_get(rootJ, "version")) >= 1) {
+      // Later versions only append slots, so read as many as are known.
+      json_t* paramBankJ = json_object_get(rootJ, "paramBank");
+      const size_t slots = std::min<size_t>(json_array_size(paramBankJ),
+                                            SLOTS_LEN);
+      for (size_t slot = 0; slot < slots; ++slot) {
+        setSlot(static_cast<ParamSlot>(slot),
+                json_number_value(json_array_get(paramBankJ, slot)));
+      }
+    } else {
+      loadLegacyParams(rootJ);
+    }
+    paramsDirty.store(true, std::memory_order_relaxed);
+  }
+
+  // Reads the params of a patch from before versioning.
+  void loadLegacyParams(json_t* rootJ) {
+    const char* key;
+    json_t* value;
+    json_object_foreach(rootJ, key, value) {
+      int32_t paramInt, modeInt, altModeInt;
+      if (sscanf(key, "%d/%d/%d", &paramInt, &modeInt, &altModeInt) != 3 ||
+          paramInt < 0 || paramInt >= PARAMS_LEN || modeInt < 0 ||
+          modeInt >= MODES_LEN || altModeInt < 0 || altModeInt > 1) {
+        continue;
+      }
+      setSlot(PARAM_SLOTS[altModeInt][modeInt][paramInt],
+              json_number_value(value));
+    }
+  }
+
+  // Stores a loaded value, clamped to the range of its param.
+  void setSlot(ParamSlot slot, double value) {
+    ParamQuantity* quantity = getParamQuantity(SLOT_PARAMS[slot]);
+    paramBank[slot] = math::clamp(static_cast<float>(value),
+                                  quantity->getMinValue(),
+                                  quantity->getMaxValue());
+  }
+
+  float& getParamRef(ParamId param) {
+    return this->getParamRef(this->altMode, this->mode, param);
+  }
+
+  // Mode, alt mode and filtering as last seen by the audio thread, packed by
+  // packLabelState(). The labels are only rewritten from the UI thread (see
+  // refreshLabels()), so the audio thread never allocates or races with
+  // getLabel().
+  std::atomic<uint8_t> labelState{packLabelState(CHORUS, false, true)};
+  // Only accessed from the UI thread, starts invalid to force a refresh.
+  uint8_t appliedLabelState = 0;
+
+  static constexpr uint8_t LABEL_STATE_VALID = 1 << 4;
+
+  static constexpr uint8_t packLabelState(Mode mode, bool altMode,
+                                          bool filterEnabled) {
+    return LABEL_STATE_VALID | mode | altMode << 2 | filterEnabled << 3;
+  }
+
+  // Called from the UI thread, rewrites the param labels if the mode has
+  // changed since they were last set.
+  void refreshLabels() {
+    uint8_t state = labelState.load(std::memory_order_relaxed);
+    if (state == appliedLabelState) {
+      return;
+    }
+    appliedLabelState = state;
+    setLabels(labelParams, state);
+  }
+
+  // Labels each param for the state packed by packLabelState().
+  static void setLabels(const LabelParams& labelParams, uint8_t state) {
+    Mode mode = static_cast<Mode>(state & 0b11);
+    bool altMode = state & 1 << 2;
+    bool filterEnabled = state & 1 << 3;
+    for (int paramInt = CASTOR_PITCH_PARAM; paramInt != PARAMS_LEN;
+         ++paramInt) {
+      ParamId p = static_cast<ParamId>(paramInt);
+      labelParams[p]->setLabel(
+          getParamLabel(altMode, mode, filterEnabled, p));
+    }
+  }
+
+  static std::string getParamLabel(bool altMode, Mode lfoMode,
+                                   bool filterEnabled, ParamId param) {
+    switch (param) {
+      case CASTOR_PITCH_PARAM:
+        return "Castor Pitch";
+      case POLLUX_PITCH_PARAM:
+        return lfoMode == HARD_SYNC ? "Pollux Pitch Ratio" : "Pollux Pitch";
+      case CASTOR_RAMP_LEVEL_PARAM:
+        return "Castor ramp level";
+      case CASTOR_PULSE_LEVEL_PARAM:
+        return "Castor Pulse Level";
+      case POLLUX_PULSE_LEVEL_PARAM:
+        return "Pollux Pulse Level";
+      case BUTTON_PARAM:
+        switch (lfoMode) {
+          case CHORUS:
+            return "Mode - Chorus";
+          case LFO_PWM:
+            return "Mode - LFO PWM";
+          case LFO_FM:
+            return "Mode - LFO FM";
+          case HARD_SYNC:
+            return "Mode - Hard Sync";
+        }
+      case CASTOR_SUB_LEVEL_PARAM:
+        return "Castor Sub Level";
+      case POLLUX_SUB_LEVEL_PARAM:
+        return "Pollux Sub Level";
+      case POLLUX_RAMP_LEVEL_PARAM:
+        return "Pollux Ramp Level";
+      case ALT_MODE_BUTTON_PARAM:
+        return altMode ? "Alt mode - enabled" : "Alt mode - disabled";
+      case CROSSFADE_PARAM:
+        return "Crossfade";
+      case CASTOR_DUTY_PARAM:
+        if (lfoMode == LFO_PWM && altMode) {
+          return "Castor pulse width centre position";
+        }
+        return "Castor Duty ratio";
+
+      case POLLUX_DUTY_PARAM:
+        if (lfoMode == LFO_PWM && altMode) {
+          return "Pollux pulse width centre position";
+        }
+        return "Pollux Duty ratio";
+      case LFO_PARAM:
+        switch (lfoMode) {
+          case CHORUS:
+            return altMode ? "LFO amplitude level" : "LFO frequency";
+          case LFO_PWM:
+            return "LFO PWM frequency";
+          case LFO_FM:
+            return "LFO FM frequency";
+          case HARD_SYNC:
+            return "LFO hard sync frequency";
+        }
+      case FILTER_ENABLE_BUTTON_PARAM:
+        return filterEnabled ? "Filter mode - enabled"
+                             : "Filter mode - disabled";
+      case PARAMS_LEN:
+        return "NOOOOOO";
+    }
+  }
+
+  float& getParamRef(bool altMode, Mode lfoMode, ParamId param) {
+    return paramBank[PARAM_SLOTS[altMode][lfoMode][param]];
+  }
+
+  Mode getMode() { return this->mode; }
+
+  // Castor's pitch from its knob, for when its input is unpatched: a +/- 3
+  // octave swing, quantized to semitones.
+  static float quantizedKnobPitch(const ParamBank& bank) {
+    const float knobPitchCv = bank[CASTOR_PITCH_SLOT] * 3.f;
+    return knobPitchCv - std::remainderf(knobPitchCv, 1.f / 12.f);
+  }
+
+  // Pollux's pitch above its base in hard sync.
+  static float hardSyncRatio(const ParamBank& bank) {
+    return (1.f + bank[POLLUX_PITCH_MULTIPLIER_SLOT]) * 1.5f;
+  }
+
+  // Value determining the frequency of the LFO in a mode.
+  static float lfoCvFor(const ParamBank& bank, Mode mode, bool altMode) {
+    // Param \in [-1, 1]
+    const float param =
+        bank[PARAM_SLOTS[mode == CHORUS || altMode][mode][LFO_PARAM]];
+    return 5.f * (param + 1.f);
+  }
+
+  // Scales the LFO's triangle in [-1, 1) for a mode.
+  static float lfoDepthFor(const ParamBank& bank, Mode mode) {
+    // We need to attenuate it based on the LFO_PARAM
+    if (mode == CHORUS || mode == HARD_SYNC) {
+      return std::log(bank[PARAM_SLOTS[false][mode][LFO_PARAM]] + 1);
+    }
+    return 1.f;
+  }
+
+  static KnobCv knobCvFor(const ParamBank& bank, Mode mode, bool altMode) {
+    const auto& slots = PARAM_SLOTS[altMode][mode];
+    return {quantizedKnobPitch(bank),       bank[slots[CASTOR_PITCH_PARAM]],
+            bank[slots[POLLUX_PITCH_PARAM]], hardSyncRatio(bank),
+            lfoCvFor(bank, mode, altMode),   lfoDepthFor(bank, mode)};
+  }
+
+  // Set from the context menu, applies PolyBLEP corrections to the waveforms.
+  // Written from the UI thread, so the audio thread loads it once per block,
+  // into activeBandLimited, in updateParams().
+  std::atomic<bool> bandLimited{false};
+  // Set from the context menu, one of 1, 2, 4 or 8. The oscillators run this
+  // many times per sample, and are decimated back down to the engine rate.
+  // Written from the UI thread, see activeOversampling.
+  std::atomic<int> oversampling{1};
+  // The oversampling the oscillators are currently set up for, loaded from
+  // oversampling once per block by updateParams().
+  int activeOversampling = 1;
+  // The band-limiting the kernel was last picked for.
+  bool activeBandLimited = false;
+  // Set from the context menu: how many detuned copies of each oscillator
+  // play every voice, 1 for none. See renderUnison().
+  std::atomic<int> unison{1};
+  // Set from the context menu, one of UNISON_DETUNES: how far, in cents, the
+  // outermost copies are detuned either side of the voice.
+  std::atomic<float> unisonDetune{20.f};
+  // The unison the lanes are currently set up for, loaded from the two above
+  // once per block by updateParams(), see updateUnison().
+  int activeUnison = 1;
+  float activeUnisonDetune = 20.f;
+  // Set when paramBank is changed from outside the audio thread.
+  std::atomic<bool> paramsDirty{true};
+  float sampleRate = 48000.f;
+
+  // The per-sample path, specialised for each combination of mode, alt mode,
+  // filtering and band-limiting.
+  using Kernel = void (Gemini::*)();
+
+  // Indexed by [altMode][filterEnabled][bandLimited].
+  using KernelsForMode =
+      std::array<std::array<std::array<Kernel, 2>, 2>, 2>;
+
+  template <Mode M>
+  static constexpr KernelsForMode kernelsForMode() {
+    return {{
+        {{
+            {&Gemini::processKernel<M, false, false, false>,
+             &Gemini::processKernel<M, false, false, true>},
+            {&Gemini::processKernel<M, false, true, false>,
+             &Gemini::processKernel<M, false, true, true>},
+        }},
+        {{
+            {&Gemini::processKernel<M, true, false, false>,
+             &Gemini::processKernel<M, true, false, true>},
+            {&Gemini::processKernel<M, true, true, false>,
+             &Gemini::processKernel<M, true, true, true>},
+        }},
+    }};
+  }
+
+  Kernel kernel = getKernel(CHORUS, false, true, false);
+
+  static Kernel getKernel(Mode mode, bool altMode, bool filterEnabled,
+                          bool bandLimited) {
+    static constexpr std::array<KernelsForMode, 4> kernels = {
+        kernelsForMode<CHORUS>(),
+        kernelsForMode<LFO_PWM>(),
+        kernelsForMode<LFO_FM>(),
+        kernelsForMode<HARD_SYNC>(),
+    };
+    return kernels[mode][altMode][filterEnabled][bandLimited];
+  }
+
+  void updateParams() {
+    bool nowAltMode = params[ALT_MODE_BUTTON_PARAM].getValue() == 1.f;
+    Mode nowMode = static_cast<Mode>(
+        static_cast<int32_t>(params[BUTTON_PARAM].getValue()));
+
+    if (nowAltMode != altMode || nowMode != mode) {
+      // Assume that users cannot click between the alt mode button and the
+      // UI controls within 2ms. Update the controls with the alt-mode (or
+      // standard) mode values (so that they know what they're altering).
+      this->altMode = nowAltMode;
+      this->mode = nowMode;
+      const auto& slots = PARAM_SLOTS[nowAltMode][nowMode];
+      for (int p = 0; p < PARAMS_LEN; ++p) {
+        if (p == BUTTON_PARAM || p == ALT_MODE_BUTTON_PARAM) {
+          continue;
+        }
+        params[p].setValue(paramBank[slots[p]]);
+      }
+    } else {
+      const auto& slots = PARAM_SLOTS[nowAltMode][nowMode];
+      for (int p = 0; p < PARAMS_LEN; ++p) {
+        paramBank[slots[p]] = params[p].getValue();
+      }
+    }
+    this->knobCv = knobCvFor(paramBank, this->mode, this->altMode);
+    bool filterEnabled = 1.f == this->getParamRef(FILTER_ENABLE_BUTTON_PARAM);
+    for (int g = 0; g < MAX_GROUPS; g++) {
+      castor[g].enableFilter(filterEnabled);
+      pollux[g].enableFilter(filterEnabled);
+    }
+    const int nowOversampling =
+        this->oversampling.load(std::memory_order_relaxed);
+    if (nowOversampling != this->activeOversampling) {
+      this->activeOversampling = nowOversampling;
+      this->updateSampleRate();
+      // The decimators hold samples at the old rate, so they start again
+      // from the block that first runs at the new one.
+      for (int g = 0; g < MAX_GROUPS; g++) {
+        castorDecimator[g].reset();
+        polluxDecimator[g].reset();
+      }
+    }
+    const int nowUnison = this->unison.load(std::memory_order_relaxed);
+    const float nowUnisonDetune =
+        this->unisonDetune.load(std::memory_order_relaxed);
+    if (nowUnison != this->activeUnison ||
+        nowUnisonDetune != this->activeUnisonDetune) {
+      this->updateUnison(nowUnison, nowUnisonDetune);
+    }
+    this->activeBandLimited =
+        this->bandLimited.load(std::memory_order_relaxed);
+    this->kernel = getKernel(this->mode, this->altMode, filterEnabled,
+                             this->activeBandLimited);
+    this->labelState.store(
+        packLabelState(this->mode, this->altMode, filterEnabled),
+        std::memory_order_relaxed);
+    for (int p = 0; p < PARAMS_LEN; ++p) {
+      seenParams[p] = params[p].getValue();
+    }
+  }
+
+  // Spreads each voice's copies evenly across the detune, a lane each. When
+  // the number of copies changes they restart at random phases, as copies
+  // that start in step sweep through each other instead of thickening.
+  void updateUnison(int copies, float detune) {
+    const bool restart = copies != this->activeUnison;
+    this->activeUnison = copies;
+    this->activeUnisonDetune = detune;
+    for (int lane = 0; lane < MAX_CHANNELS; lane++) {
+      const float spread =
+          copies > 1 ? 2.f * (lane % copies) / (copies - 1) - 1.f : 0.f;
+      unisonPitch[lane / 4][lane % 4] = spread * activeUnisonDetune / 1200.f;
+    }
+    if (!restart || copies == 1) {
+      return;
+    }
+    // In [-1, 1) in each lane.
+    auto random4 = [] {
+      simd::float_4 value;
+      for (int i = 0; i < 4; i++) {
+        value[i] = 2.f * random::uniform() - 1.f;
+      }
+      return value;
+    };
+    for (int g = 0; g < MAX_GROUPS; g++) {
+      castor[g].setPhase(random4(),
+                         wide::ifelse(random4() < 0.f, -1.f, 1.f));
+      pollux[g].setPhase(random4(),
+                         wide::ifelse(random4() < 0.f, -1.f, 1.f));
+      castor[g].resetFilters();
+      pollux[g].resetFilters();
+      castorDecimator[g].reset();
+      polluxDecimator[g].reset();
+    }
+  }
+
+  // Whether anything updateParams() reads has changed since it last ran.
+  bool paramsChanged() {
+    if (paramsDirty.exchange(false, std::memory_order_relaxed) ||
+        bandLimited.load(std::memory_order_relaxed) != activeBandLimited ||
+        oversampling.load(std::memory_order_relaxed) != activeOversampling ||
+        unison.load(std::memory_order_relaxed) != activeUnison ||
+        unisonDetune.load(std::memory_order_relaxed) != activeUnisonDetune) {
+      return true;
+    }
+    for (int p = 0; p < PARAMS_LEN; ++p) {
+      if (params[p].getValue() != seenParams[p]) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /*
+   * Main logic thread
+   *
+   * Gemini is made up of two oscillators - Castor and Pollux. Castor can be
+   * thought of as the main driving oscillator, with its frequency influencing
+   * the frequency of Pollux (unless a separate CV input is provided).
+   *
+   * Each mode has a different behaviour:
+   *   * Chorus - subtle frequency modulation of Pollux only.
+   *   * LFO PWM - pulse width influenced by LFO output.
+   *   * LFO FM - frequency influenced by LFO output.
+   *   * Hard sync - Pollux gets reset every time Castor does. Pollux's
+   *       frequency becomes a multiple of Castor's.
+   *
+   * Update user-driven parameters between blocks, and only when one of them
+   * has changed. This also picks the kernel for the current mode, so the
+   * per-sample path below never checks the mode itself. The levels, crossfade
+   * and duty knobs then slew towards their new values over SLEW_TIME, ramping
+   * through each block, so that turning them doesn't click.
+   *
+   * Update the pitch of the oscillators each tick, as they are externally
+   * driven and can change more frequently. The oscillators need updating every
+   * tick to ensure a smooth output.
+   *
+   * When the oscillators' frequency changes, keep the same phase to ensure a
+   * smooth transition between different frequencies.
+   *
+   * Frames are rendered BLOCK_SIZE at a time, so that work that doesn't change
+   * within a block is done once per block, and each stage of the oscillators
+   * runs over the whole block. Each frame's CV is captured into the block
+   * while the previous block's output is played back, delaying the outputs
+   * by LATENCY frames.
+   *
+   * Polyphony follows the channel count of the pitch inputs, with each voice
+   * having its own Castor and Pollux. Voices are processed four at a time, one
+   * per SIMD lane. A single voice instead runs its Castor and Pollux side by
+   * side in one vector.
+   */
+  void process(const ProcessArgs& args) override {
+    captureFrame(blockPosition);
+    playFrame(blockPosition);
+    if (++blockPosition == BLOCK_SIZE) {
+      blockPosition = 0;
+      if (paramsChanged()) {
+        updateParams();
+      }
+      renderBlock();
+    }
+  }
+
+  // Frames of delay between the inputs and the outputs of process().
+  static constexpr int LATENCY = BLOCK_SIZE;
+
+  // Reads the inputs into frame `position` of the block.
+  void captureFrame(int position) {
+    const int channels =
+        std::max({1, inputs[CASTOR_PITCH_INPUT].getChannels(),
+                  inputs[POLLUX_PITCH_INPUT].getChannels()});
+    block.channels[position] = channels;
+    for (int i = 0; i < INPUTS_LEN; i++) {
+      const bool connected = inputs[i].isConnected();
+      block.connected[i][position] = connected;
+      if (!connected) {
+        continue;
+      }
+      for (int c = 0; c < channels; c += 4) {
+        groupBlocks[c / 4].cv[i][position] =
+            inputs[i].getPolyVoltageSimd<simd::float_4>(c);
+      }
+    }
+  }
+
+  // Writes frame `position` of the block's output.
+  void playFrame(int position) {
+    const int channels = block.outChannels[position];
+    for (int o = 0; o < OUTPUTS_LEN; o++) {
+      for (int c = 0; c < channels; c += 4) {
+        outputs[o].setVoltageSimd(groupBlocks[c / 4].out[o][position], c);
+      }
+      outputs[o].setChannels(channels);
+    }
+  }
+
+  // Renders the captured frames into the block's output. Offline callers can
+  // fill the block with captureFrame() and call this directly, without the
+  // latency of process().
+  void renderBlock() { (this->*kernel)(); }
+
+  template <Mode M, bool ALT, bool FILTER, bool BAND_LIMITED>
+  void processKernel() {
+    // Params only change between blocks, so the LFO runs at the block rate.
+    lfo.updatePitch(knobCv.lfoCv);
+    lfo.advanceTriangle(block.lfo, BLOCK_SIZE, knobCv.lfoDepth);
+
+    const int channels =
+        *std::max_element(block.channels, block.channels + BLOCK_SIZE);
+    std::copy(block.channels, block.channels + BLOCK_SIZE, block.outChannels);
+
+    this->stepSlews<M, ALT>();
+    const Signals<float> castorFrom = levelsFrom(castorLevelSlew);
+    const Signals<float> castorTo = levelsTo(castorLevelSlew);
+    const Signals<float> polluxFrom = levelsFrom(polluxLevelSlew);
+    const Signals<float> polluxTo = levelsTo(polluxLevelSlew);
+    const ParamSlew& crossfade = crossfadeSlew;
+
+    // Only oscillators heard at a connected output are rendered. The others
+    // just skip their phase ahead a block at a time, so that they come back
+    // close to where they would have been, with their filters at rest.
+    const bool mixConnected = outputs[MIX_OUTPUT].isConnected();
+    const bool castorHeard =
+        anyHeard(isHeard(castorFrom, castorTo)) &&
+        (outputs[CASTOR_MIX_OUTPUT].isConnected() ||
+         (mixConnected && (crossfade.from != 1.f || crossfade.to != 1.f)));
+    const bool polluxHeard =
+        anyHeard(isHeard(polluxFrom, polluxTo)) &&
+        (outputs[POLLUX_MIX_OUTPUT].isConnected() ||
+         (mixConnected && (crossfade.from != 0.f || crossfade.to != 0.f)));
+    if (castorHeard && !this->castorHeard) {
+      for (int g = 0; g < MAX_GROUPS; g++) {
+        castor[g].resetFilters();
+        castorDecimator[g].reset();
+      }
+    }
+    if (polluxHeard && !this->polluxHeard) {
+      for (int g = 0; g < MAX_GROUPS; g++) {
+        pollux[g].resetFilters();
+        polluxDecimator[g].reset();
+      }
+    }
+    this->castorHeard = castorHeard;
+    this->polluxHeard = polluxHeard;
+
+    // In unison the lanes hold copies of each voice rather than voices.
+    if (activeUnison > 1) {
+      this->renderUnison<M, ALT, FILTER, BAND_LIMITED>(channels);
+      return;
+    }
+
+    // A single voice that runs both oscillators runs them as a pair, rather
+    // than each in a quarter of a vector.
+    if (channels == 1 && polluxHeard && (castorHeard || M == HARD_SYNC)) {
+      this->renderPair<M, ALT, FILTER, BAND_LIMITED>();
+      return;
+    }
+
+    // Each run of voices goes to the widest kernel it fills more than half
+    // of, so that a few voices don't pay for the lanes of many.
+    for (int c = 0; c < channels;) {
+      const int g = c / 4;
+#ifdef GEMINI_WIDE_KERNELS
+      if (isa == Isa::AVX512 && channels - c > 8) {
+        this->renderVoicesAvx512<M, ALT, FILTER, BAND_LIMITED>(g);
+        c += 16;
+        continue;
+      }
+      if (isa != Isa::SSE && channels - c > 4) {
+        this->renderVoicesAvx2<M, ALT, FILTER, BAND_LIMITED>(g);
+        c += 8;
+        continue;
+      }
+#endif
+      this->renderVoices<simd::float_4, M, ALT, FILTER, BAND_LIMITED>(g);
+      c += 4;
+    }
+  }
+
+  // Renders the block for voices [4g, 4g + V::size). Voices are stored four
+  // to a group, so a wider kernel gathers the groups it covers into its
+  // Voices for the block, then scatters them back.
+  template <typename V, Mode M, bool ALT, bool FILTER, bool BAND_LIMITED>
+  void renderVoices(int g) {
+    if constexpr (std::is_same_v<V, simd::float_4>) {
+      this->renderLanes<V, M, ALT, FILTER, BAND_LIMITED>(
+          g, castor[g], pollux[g], castorDecimator[g], polluxDecimator[g]);
+    } else {
+#ifdef GEMINI_WIDE_KERNELS
+      constexpr int GROUPS = V::size / 4;
+      assert(g + GROUPS <= MAX_GROUPS);
+      Voices<V>& voices = gathered<V>();
+      gatherVoices(voices.castor, &castor[g], GROUPS);
+      gatherVoices(voices.pollux, &pollux[g], GROUPS);
+      gatherVoices(voices.castorDecimator, &castorDecimator[g], GROUPS);
+      gatherVoices(voices.polluxDecimator, &polluxDecimator[g], GROUPS);
+      this->renderLanes<V, M, ALT, FILTER, BAND_LIMITED>(
+          g, voices.castor, voices.pollux, voices.castorDecimator,
+          voices.polluxDecimator);
+      scatterVoices(voices.castor, &castor[g], GROUPS);
+      scatterVoices(voices.pollux, &pollux[g], GROUPS);
+      scatterVoices(voices.castorDecimator, &castorDecimator[g], GROUPS);
+      scatterVoices(voices.polluxDecimator, &polluxDecimator[g], GROUPS);
+#endif
+    }
+  }
+
+#ifdef GEMINI_WIDE_KERNELS
+  // renderVoices() 8 and 16 lanes at a time, compiled for AVX2 and AVX-512
+  // with everything it calls inlined, so that all of it runs on the wider
+  // instructions. The rest of the plugin keeps Rack's baseline, and these are
+  // only called once supportedIsa() has found the CPU runs them.
+  template <Mode M, bool ALT, bool FILTER, bool BAND_LIMITED>
+  [[gnu::target("avx2,fma"), gnu::flatten]] void renderVoicesAvx2(int g) {
+    this->renderVoices<wide::float_8, M, ALT, FILTER, BAND_LIMITED>(g);
+  }
+
+  template <Mode M, bool ALT, bool FILTER, bool BAND_LIMITED>
+  [[gnu::target("avx512f,avx2,fma"), gnu::flatten]] void renderVoicesAvx512(
+      int g) {
+    this->renderVoices<wide::float_16, M, ALT, FILTER, BAND_LIMITED>(g);
+  }
+#endif
+
+  // Runs the oscillators of voices [4g, 4g + V::size) through the block, one
+  // voice per lane, and writes their outputs.
+  template <typename V, Mode M, bool ALT, bool FILTER, bool BAND_LIMITED>
+  void renderLanes(int g, OscillatorState<V>& castor,
+                   OscillatorState<V>& pollux, Decimator<V>& castorDecimator,
+                   Decimator<V>& polluxDecimator) {
+    const ParamSlew& crossfade = crossfadeSlew;
+    V castorPitch[BLOCK_SIZE];
+    V polluxPitch[BLOCK_SIZE];
+    V castorDuty[BLOCK_SIZE];
+    V polluxDuty[BLOCK_SIZE];
+    // CV is only read at the engine rate.
+    this->getPitchCv<M, ALT>(g, castorPitch, polluxPitch);
+    if (castorHeard) {
+      this->getDutyCycle<M, CASTOR_DUTY_INPUT>(g, castorDutySlew, castorDuty);
+    }
+    if (polluxHeard) {
+      this->getDutyCycle<M, POLLUX_DUTY_INPUT>(g, polluxDutySlew, polluxDuty);
+    }
+
+    V castorOut[BLOCK_SIZE];
+    V polluxOut[BLOCK_SIZE];
+    this->runLanes<V, M, FILTER, BAND_LIMITED>(
+        castor, pollux, castorDecimator, polluxDecimator, castorPitch,
+        polluxPitch, castorDuty, polluxDuty, castorOut, polluxOut);
+
+    // Audio signals are typically +/-5V
+    // https://vcvrack.com/manual/VoltageStandards
+    for (int f = 0; f < BLOCK_SIZE; f++) {
+      this->setOut(CASTOR_MIX_OUTPUT, g, f, castorOut[f]);
+      this->setOut(POLLUX_MIX_OUTPUT, g, f, polluxOut[f]);
+      this->setOut(MIX_OUTPUT, g, f,
+                   this->getMix(
+                       castorOut[f], polluxOut[f],
+                       crossfade.at(static_cast<float>(f + 1) / BLOCK_SIZE)));
+    }
+  }
+
+  // Runs a vector of oscillators through the block at the given pitch and
+  // duty per frame, and fills their decimated outputs. An oscillator's duty
+  // is only read, and its output only non-zero, when it's heard.
+  template <typename V, Mode M, bool FILTER, bool BAND_LIMITED>
+  void runLanes(OscillatorState<V>& castor, OscillatorState<V>& pollux,
+                Decimator<V>& castorDecimator, Decimator<V>& polluxDecimator,
+                const V* castorPitch, const V* polluxPitch,
+                const V* castorDuty, const V* polluxDuty, V* castorOut,
+                V* polluxOut) {
+    const Signals<float> castorFrom = levelsFrom(castorLevelSlew);
+    const Signals<float> castorTo = levelsTo(castorLevelSlew);
+    const Signals<float> polluxFrom = levelsFrom(polluxLevelSlew);
+    const Signals<float> polluxTo = levelsTo(polluxLevelSlew);
+    // A sync leader has to run for its follower to be restarted.
+    const bool castorRuns = castorHeard || (M == HARD_SYNC && polluxHeard);
+
+    const int oversampling = this->activeOversampling;
+    // In hard sync, each of Castor's wraps restarts Pollux.
+    constexpr HardSync CASTOR_SYNC =
+        M == HARD_SYNC ? HardSync::LEADER : HardSync::NONE;
+    constexpr HardSync POLLUX_SYNC =
+        M == HARD_SYNC ? HardSync::FOLLOWER : HardSync::NONE;
+
+    // Oscillators that aren't heard skip the whole block at once.
+    if (!castorRuns) {
+      castor.skip(castorPitch, BLOCK_SIZE, oversampling);
+    }
+    if (!polluxHeard) {
+      pollux.skip(polluxPitch, BLOCK_SIZE, oversampling);
+    }
+    // The others run a slice of frames at a time, as many as fill an
+    // OscillatorBlock, with the levels ramping through each slice.
+    const int frames = OscillatorBlock<V>::MAX_SAMPLES / oversampling;
+    OscillatorBlock<V> castorBlock;
+    OscillatorBlock<V> polluxBlock;
+    for (int start = 0; start < BLOCK_SIZE; start += frames) {
+      const float t0 = static_cast<float>(start) / BLOCK_SIZE;
+      const float t1 = static_cast<float>(start + frames) / BLOCK_SIZE;
+      if (castorRuns) {
+        castor.template advance<CASTOR_SYNC>(castorBlock, castorPitch + start,
+                                             frames, oversampling);
+      }
+      if (castorHeard) {
+        castor.template render<FILTER, BAND_LIMITED>(
+            castorBlock, castorDuty + start, frames, oversampling,
+            levelsAt(castorFrom, castorTo, t0),
+            levelsAt(castorFrom, castorTo, t1));
+      }
+
+      // Pollux's behaviour generally depends on the current mode.
+      if (polluxHeard) {
+        pollux.template advance<POLLUX_SYNC>(polluxBlock, polluxPitch + start,
+                                             frames, oversampling,
+                                             &castorBlock);
+        pollux.template render<FILTER, BAND_LIMITED>(
+            polluxBlock, polluxDuty + start, frames, oversampling,
+            levelsAt(polluxFrom, polluxTo, t0),
+            levelsAt(polluxFrom, polluxTo, t1));
+      }
+
+      for (int f = 0; f < frames; f++) {
+        castorOut[start + f] =
+            castorHeard ? castorDecimator.process(
+                              &castorBlock.out[f * oversampling], oversampling)
+                        : 0.f;
+        polluxOut[start + f] =
+            polluxHeard ? polluxDecimator.process(
+                              &polluxBlock.out[f * oversampling], oversampling)
+                        : 0.f;
+      }
+    }
+  }
+
+  // Renders each voice as activeUnison copies of its Castor and Pollux, a
+  // copy per lane, each offset by its lane's unisonPitch, then sums each
+  // voice's copies into its outputs. The copies follow the voice's CV, LFO
+  // included, so each only adds the work of its own lane. Voices past those
+  // whose copies fit in the lanes are dropped.
+  template <Mode M, bool ALT, bool FILTER, bool BAND_LIMITED>
+  void renderUnison(int channels) {
+    using V = simd::float_4;
+    const int copies = this->activeUnison;
+    const int voices = std::min(channels, MAX_CHANNELS / copies);
+    const int lanes = voices * copies;
+    for (int f = 0; f < BLOCK_SIZE; f++) {
+      block.outChannels[f] = std::min(block.outChannels[f], voices);
+    }
+
+    // Each voice's CV, then each lane's, as [frame][voice or lane].
+    float castorPitch[BLOCK_SIZE][MAX_CHANNELS];
+    float polluxPitch[BLOCK_SIZE][MAX_CHANNELS];
+    float castorDuty[BLOCK_SIZE][MAX_CHANNELS];
+    float polluxDuty[BLOCK_SIZE][MAX_CHANNELS];
+    for (int g = 0; g * 4 < voices; g++) {
+      V castorV[BLOCK_SIZE];
+      V polluxV[BLOCK_SIZE];
+      this->getPitchCv<M, ALT>(g, castorV, polluxV);
+      for (int f = 0; f < BLOCK_SIZE; f++) {
+        castorV[f].store(&castorPitch[f][4 * g]);
+        polluxV[f].store(&polluxPitch[f][4 * g]);
+      }
+      if (castorHeard) {
+        this->getDutyCycle<M, CASTOR_DUTY_INPUT>(g, castorDutySlew, castorV);
+      }
+      if (polluxHeard) {
+        this->getDutyCycle<M, POLLUX_DUTY_INPUT>(g, polluxDutySlew, polluxV);
+      }
+      for (int f = 0; f < BLOCK_SIZE; f++) {
+        castorV[f].store(&castorDuty[f][4 * g]);
+        polluxV[f].store(&polluxDuty[f][4 * g]);
+      }
+    }
+
+    float castorLanes[BLOCK_SIZE][MAX_CHANNELS];
+    float polluxLanes[BLOCK_SIZE][MAX_CHANNELS];
+    for (int g = 0; g * 4 < lanes; g++) {
+      // The voice of each lane. Lanes past the last copy repeat the last
+      // voice, and aren't heard.
+      int voice[4];
+      for (int i = 0; i < 4; i++) {
+        voice[i] = std::min((4 * g + i) / copies, voices - 1);
+      }
+      auto gather = [&](const float(*cv)[MAX_CHANNELS], int f) {
+        return V(cv[f][voice[0]], cv[f][voice[1]], cv[f][voice[2]],
+                 cv[f][voice[3]]);
+      };
+      V castorV[BLOCK_SIZE];
+      V polluxV[BLOCK_SIZE];
+      V castorDutyV[BLOCK_SIZE];
+      V polluxDutyV[BLOCK_SIZE];
+      for (int f = 0; f < BLOCK_SIZE; f++) {
+        castorV[f] = gather(castorPitch, f) + unisonPitch[g];
+        polluxV[f] = gather(polluxPitch, f) + unisonPitch[g];
+        if (castorHeard) {
+          castorDutyV[f] = gather(castorDuty, f);
+        }
+        if (polluxHeard) {
+          polluxDutyV[f] = gather(polluxDuty, f);
+        }
+      }
+
+      V castorOut[BLOCK_SIZE];
+      V polluxOut[BLOCK_SIZE];
+      this->runLanes<V, M, FILTER, BAND_LIMITED>(
+          castor[g], pollux[g], castorDecimator[g], polluxDecimator[g],
+          castorV, polluxV, castorDutyV, polluxDutyV, castorOut, polluxOut);
+      for (int f = 0; f < BLOCK_SIZE; f++) {
+        castorOut[f].store(&castorLanes[f][4 * g]);
+        polluxOut[f].store(&polluxLanes[f][4 * g]);
+      }
+    }
+
+    // The copies are detuned and start out of phase, so they add up like
+    // noise: scaling by 1/sqrt(copies) keeps the voice at the level of one.
+    const float gain = 1.f / std::sqrt(static_cast<float>(copies));
+    const ParamSlew& crossfade = crossfadeSlew;
+    for (int f = 0; f < BLOCK_SIZE; f++) {
+      float castorVoices[MAX_CHANNELS] = {};
+      float polluxVoices[MAX_CHANNELS] = {};
+      for (int lane = 0; lane < lanes; lane++) {
+        castorVoices[lane / copies] += castorLanes[f][lane];
+        polluxVoices[lane / copies] += polluxLanes[f][lane];
+      }
+      for (int g = 0; g * 4 < voices; g++) {
+        const V castorOut = V::load(&castorVoices[4 * g]) * gain;
+        const V polluxOut = V::load(&polluxVoices[4 * g]) * gain;
+        this->setOut(CASTOR_MIX_OUTPUT, g, f, castorOut);
+        this->setOut(POLLUX_MIX_OUTPUT, g, f, polluxOut);
+        this->setOut(MIX_OUTPUT, g, f,
+                     this->getMix(castorOut, polluxOut,
+                                  crossfade.at(static_cast<float>(f + 1) /
+                                               BLOCK_SIZE)));
+      }
+    }
+  }
+
+  // Renders the first voice with its Castor and Pollux gathered into a Pair
+  // for the block. Castor runs even when it isn't heard, at zero level, as
+  // it only does so to restart Pollux in hard sync.
+  template <Mode M, bool ALT, bool FILTER, bool BAND_LIMITED>
+  void renderPair() {
+    using V = simd::float_4;
+    Pair& pair = this->pair;
+    gatherLane(pair.oscillators, castor[0], CASTOR_LANE);
+    gatherLane(pair.oscillators, pollux[0], POLLUX_LANE);
+    gatherLane(pair.decimator, castorDecimator[0], CASTOR_LANE);
+    gatherLane(pair.decimator, polluxDecimator[0], POLLUX_LANE);
+
+    const Signals<float> silent = {0.f, 0.f, 0.f};
+    const Signals<V> from =
+        pairLanes(castorHeard ? levelsFrom(castorLevelSlew) : silent,
+                  levelsFrom(polluxLevelSlew));
+    const Signals<V> to =
+        pairLanes(castorHeard ? levelsTo(castorLevelSlew) : silent,
+                  levelsTo(polluxLevelSlew));
+    const ParamSlew& crossfade = crossfadeSlew;
+    const int oversampling = this->activeOversampling;
+
+    V castorPitch[BLOCK_SIZE];
+    V polluxPitch[BLOCK_SIZE];
+    V castorDuty[BLOCK_SIZE];
+    V polluxDuty[BLOCK_SIZE];
+    this->getPitchCv<M, ALT>(0, castorPitch, polluxPitch);
+    this->getDutyCycle<M, CASTOR_DUTY_INPUT>(0, castorDutySlew, castorDuty);
+    this->getDutyCycle<M, POLLUX_DUTY_INPUT>(0, polluxDutySlew, polluxDuty);
+    V pitch[BLOCK_SIZE];
+    V duty[BLOCK_SIZE];
+    for (int f = 0; f < BLOCK_SIZE; f++) {
+      pitch[f] = pairLanes(castorPitch[f][0], polluxPitch[f][0]);
+      duty[f] = pairLanes(castorDuty[f][0], polluxDuty[f][0]);
+    }
+
+    constexpr HardSync SYNC =
+        M == HARD_SYNC ? HardSync::PAIRED : HardSync::NONE;
+    // In slices, as runLanes().
+    const int frames = OscillatorBlock<V>::MAX_SAMPLES / oversampling;
+    OscillatorBlock<V> pairBlock;
+    for (int start = 0; start < BLOCK_SIZE; start += frames) {
+      pair.oscillators.template advance<SYNC>(pairBlock, pitch + start,
+                                              frames, oversampling);
+      pair.oscillators.template render<FILTER, BAND_LIMITED>(
+          pairBlock, duty + start, frames, oversampling,
+          levelsAt(from, to, static_cast<float>(start) / BLOCK_SIZE),
+          levelsAt(from, to, static_cast<float>(start + frames) / BLOCK_SIZE));
+
+      for (int i = 0; i < frames; i++) {
+        const int f = start + i;
+        const V out = pair.decimator.process(&pairBlock.out[i * oversampling],
+                                             oversampling);
+        const V castorOut = castorHeard ? out[CASTOR_LANE] : 0.f;
+        const V polluxOut = out[POLLUX_LANE];
+        this->setOut(CASTOR_MIX_OUTPUT, 0, f, castorOut);
+        this->setOut(POLLUX_MIX_OUTPUT, 0, f, polluxOut);
+        this->setOut(
+            MIX_OUTPUT, 0, f,
+            this->getMix(castorOut, polluxOut,
+                         crossfade.at(static_cast<float>(f + 1) / BLOCK_SIZE)));
+      }
+    }
+
+    scatterLane(pair.oscillators, castor[0], CASTOR_LANE);
+    scatterLane(pair.oscillators, pollux[0], POLLUX_LANE);
+    scatterLane(pair.decimator, castorDecimator[0], CASTOR_LANE);
+    scatterLane(pair.decimator, polluxDecimator[0], POLLUX_LANE);
+  }
+
+  // A value for each oscillator of a Pair.
+  static simd::float_4 pairLanes(float castor, float pollux) {
+    simd::float_4 lanes = 0.f;
+    lanes[CASTOR_LANE] = castor;
+    lanes[POLLUX_LANE] = pollux;
+    return lanes;
+  }
+
+  static Signals<simd::float_4> pairLanes(const Signals<float>& castor,
+                                          const Signals<float>& pollux) {
+    return {pairLanes(castor.ramp, pollux.ramp),
+            pairLanes(castor.pulse, pollux.pulse),
+            pairLanes(castor.sub, pollux.sub)};
+  }
+
+  void onSampleRateChange(const SampleRateChangeEvent& e) override {
+    this->sampleRate = e.sampleRate;
+    this->updateSampleRate();
+  }
+
+  // The oscillators run at the oversampled rate, the LFO at the engine rate.
+  void updateSampleRate() {
+    slewStep = BLOCK_SIZE / (SLEW_TIME * sampleRate);
+    lfo.updateSampleRate(sampleRate);
+    for (int g = 0; g < MAX_GROUPS; g++) {
+      castor[g].updateSampleRate(sampleRate * activeOversampling);
+      pollux[g].updateSampleRate(sampleRate * activeOversampling);
+    }
+  }
+
+ private:
+  template <Mode M, bool ALT, ParamId P>
+  float& getParamRef() {
+    constexpr ParamSlot slot = PARAM_SLOTS[ALT][M][P];
+    return paramBank[slot];
+  }
+
+  template <typename V>
+  V getMix(V castor, V pollux, float mix) {
+    return wide::crossfade(castor, pollux, mix);
+  }
+
+  // Input's CV at frame f for voices [4g, 4g + V::size). Only valid while
+  // the input is connected.
+  template <typename V>
+  V getCv(InputId input, int g, int f) {
+    if constexpr (std::is_same_v<V, simd::float_4>) {
+      return groupBlocks[g].cv[input][f];
+    } else {
+      V cv;
+      for (int p = 0; p < V::size / 4; p++) {
+        setLanes(cv, groupBlocks[g + p].cv[input][f], p);
+      }
+      return cv;
+    }
+  }
+
+  // Sets output's voltage at frame f for voices [4g, 4g + V::size).
+  template <typename V>
+  void setOut(OutputId output, int g, int f, V out) {
+    if constexpr (std::is_same_v<V, simd::float_4>) {
+      groupBlocks[g].out[output][f] = out;
+    } else {
+      for (int p = 0; p < V::size / 4; p++) {
+        getLanes(out, groupBlocks[g + p].out[output][f], p);
+      }
+    }
+  }
+
+  // How far param's slew moves in a block, so that a move across its whole
+  // range takes SLEW_TIME.
+  float slewStepOf(ParamId param) const {
+    return slewStep * PARAM_RANGES[param].size();
+  }
+
+  // Moves the smoothed knobs a block towards their values in the bank. Only
+  // the levels, crossfade and duty are smoothed: pitch and the sync ratio
+  // change the oscillators' increments, see KnobCv.
+  template <Mode M, bool ALT>
+  void stepSlews() {
+    castorLevelSlew.ramp.step(getParamRef<M, ALT, CASTOR_RAMP_LEVEL_PARAM>(),
+                              slewStepOf(CASTOR_RAMP_LEVEL_PARAM));
+    castorLevelSlew.pulse.step(getParamRef<M, ALT, CASTOR_PULSE_LEVEL_PARAM>(),
+                               slewStepOf(CASTOR_PULSE_LEVEL_PARAM));
+    castorLevelSlew.sub.step(getParamRef<M, ALT, CASTOR_SUB_LEVEL_PARAM>(),
+                             slewStepOf(CASTOR_SUB_LEVEL_PARAM));
+    polluxLevelSlew.ramp.step(getParamRef<M, ALT, POLLUX_RAMP_LEVEL_PARAM>(),
+                              slewStepOf(POLLUX_RAMP_LEVEL_PARAM));
+    polluxLevelSlew.pulse.step(getParamRef<M, ALT, POLLUX_PULSE_LEVEL_PARAM>(),
+                               slewStepOf(POLLUX_PULSE_LEVEL_PARAM));
+    polluxLevelSlew.sub.step(getParamRef<M, ALT, POLLUX_SUB_LEVEL_PARAM>(),
+                             slewStepOf(POLLUX_SUB_LEVEL_PARAM));
+    crossfadeSlew.step(getParamRef<M, ALT, CROSSFADE_PARAM>(),
+                       slewStepOf(CROSSFADE_PARAM));
+    castorDutySlew.step(getParamRef<M, ALT, CASTOR_DUTY_PARAM>(),
+                        slewStepOf(CASTOR_DUTY_PARAM));
+    polluxDutySlew.step(getParamRef<M, ALT, POLLUX_DUTY_PARAM>(),
+                        slewStepOf(POLLUX_DUTY_PARAM));
+  }
+
+  // Fills duty with values in [-1, 1] for voices [4g, 4g + V::size), per
+  // frame, with the knob ramping through the block.
+  template <Mode M, InputId INPUT, typename V>
+  void getDutyCycle(int g, const ParamSlew& knob, V* duty) {
+    for (int f = 0; f < BLOCK_SIZE; f++) {
+      const float param = knob.at(static_cast<float>(f + 1) / BLOCK_SIZE);
+      V baseDutyCycle = param;
+      if (block.connected[INPUT][f]) {
+        baseDutyCycle += getCv<V>(INPUT, g, f) / 5.f;
+      }
+      if constexpr (M == LFO_PWM) {
+        // LFO Value \in [-1, 1]
+        baseDutyCycle += block.lfo[f];
+      }
+      duty[f] = wide::clamp(baseDutyCycle, -1.f, 1.f);
+    }
+  }
+
+  // Fills the pitch of Castor and Pollux for voices [4g, 4g + V::size), per
+  // frame.
+  template <Mode M, bool ALT, typename V>
+  void getPitchCv(int g, V* castorPitch, V* polluxPitch) {
+    const KnobCv& knobs = knobCv;
+    for (int f = 0; f < BLOCK_SIZE; f++) {
+      V castorCv =
+          block.connected[CASTOR_PITCH_INPUT][f]
+              ? getCv<V>(CASTOR_PITCH_INPUT, g, f) + knobs.castorOffset
+              : knobs.castorPitch;
+      if constexpr (M == LFO_FM) {
+        castorCv += block.lfo[f];
+      }
+      castorPitch[f] = castorCv;
+
+      if constexpr (M == HARD_SYNC) {
+        V basePitchCv =
+            block.connected[POLLUX_PITCH_INPUT][f]
+                ? wide::clamp(getCv<V>(POLLUX_PITCH_INPUT, g, f), -6.f, 6.f)
+                : castorCv;
+        polluxPitch[f] = basePitchCv + knobs.syncRatio;
+      } else {
+        V polluxCv = (block.connected[POLLUX_PITCH_INPUT][f]
+                          ? getCv<V>(POLLUX_PITCH_INPUT, g, f)
+                          : castorCv) +
+                     knobs.polluxOffset;
+        if constexpr (M == CHORUS) {
+          polluxCv += block.lfo[f];
+        }
+        polluxPitch[f] = polluxCv;
+      }
+    }
+  }
+};
+
+// Places Gemini's screws, knobs, buttons and ports where its panel has them,
+// for GeminiWidget and for GeminiBankWidget, whose panel shares the layout.
+inline void addGeminiControls(ModuleWidget* widget, Module* module) {
+  const float width = widget->box.size.x;
+  widget->addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, 0)));
+  widget->addChild(
+      createWidget<ScrewSilver>(Vec(width - 2 * RACK_GRID_WIDTH, 0)));
+  widget->addChild(createWidget<ScrewSilver>(
+      Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+  widget->addChild(createWidget<ScrewSilver>(
+      Vec(width - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+
+  widget->addParam(createParamCentered<RoundHugeBlackKnob>(
+      mm2px(Vec(16.48, 21.259)), module, Gemini::CASTOR_PITCH_PARAM));
+  widget->addParam(createParamCentered<RoundHugeBlackKnob>(
+      mm2px(Vec(54.08, 21.259)), module, Gemini::POLLUX_PITCH_PARAM));
+  widget->addParam(createParamCentered<RoundBigBlackKnob>(
+      mm2px(Vec(35.28, 42.455)), module, Gemini::LFO_PARAM));
+  widget->addParam(createParamCentered<RoundBigBlackKnob>(
+      mm2px(Vec(12.331, 52.077)), module, Gemini::CASTOR_DUTY_PARAM));
+  widget->addParam(createParamCentered<RoundBigBlackKnob>(
+      mm2px(Vec(58.198, 52.077)), module, Gemini::POLLUX_DUTY_PARAM));
+  widget->addParam(createParamCentered<RoundBigBlackKnob>(
+      mm2px(Vec(35.28, 64.716)), module, Gemini::CROSSFADE_PARAM));
+  widget->addParam(createParamCentered<RoundBlackKnob>(
+      mm2px(Vec(7.854, 80.97)), module, Gemini::CASTOR_RAMP_LEVEL_PARAM));
+  widget->addParam(createParamCentered<RoundBlackKnob>(
+      mm2px(Vec(21.536, 80.97)), module, Gemini::CASTOR_PULSE_LEVEL_PARAM));
+  widget->addParam(createParamCentered<RoundBlackKnob>(
+      mm2px(Vec(62.447, 80.97)), module, Gemini::POLLUX_RAMP_LEVEL_PARAM));
+  widget->addParam(createParamCentered<RoundBlackKnob>(
+      mm2px(Vec(21.536, 95.994)), module, Gemini::CASTOR_SUB_LEVEL_PARAM));
+  widget->addParam(createParamCentered<RoundBlackKnob>(
+      mm2px(Vec(48.834, 95.994)), module, Gemini::POLLUX_SUB_LEVEL_PARAM));
+  widget->addParam(createParamCentered<RoundBlackKnob>(
+      mm2px(Vec(48.834, 80.97)), module, Gemini::POLLUX_PULSE_LEVEL_PARAM));
+  widget->addParam(createParamCentered<RoundBlackSnapKnob>(
+      mm2px(Vec(35.25, 88.806)), module, Gemini::BUTTON_PARAM));
+  widget->addParam(createParamCentered<VCVLatch>(
+      mm2px(Vec(35.25, 99.963)), module, Gemini::ALT_MODE_BUTTON_PARAM));
+
+  widget->addParam(createParamCentered<VCVLatch>(
+      mm2px(Vec(35.25, 15.00)), module, Gemini::FILTER_ENABLE_BUTTON_PARAM));
+
+  widget->addInput(createInputCentered<PJ301MPort>(
+      mm2px(Vec(7.854, 95.994)), module, Gemini::CASTOR_DUTY_INPUT));
+  widget->addInput(createInputCentered<PJ301MPort>(
+      mm2px(Vec(62.477, 95.994)), module, Gemini::POLLUX_DUTY_INPUT));
+  widget->addInput(createInputCentered<PJ301MPort>(
+      mm2px(Vec(7.854, 111.12)), module, Gemini::CASTOR_PITCH_INPUT));
+  widget->addInput(createInputCentered<PJ301MPort>(
+      mm2px(Vec(62.447, 111.12)), module, Gemini::POLLUX_PITCH_INPUT));
+
+  widget->addOutput(createOutputCentered<PJ301MPort>(
+      mm2px(Vec(21.536, 111.12)), module, Gemini::CASTOR_MIX_OUTPUT));
+  widget->addOutput(createOutputCentered<PJ301MPort>(
+      mm2px(Vec(35.239, 111.12)), module, Gemini::MIX_OUTPUT));
+  widget->addOutput(createOutputCentered<PJ301MPort>(
+      mm2px(Vec(48.761, 111.12)), module, Gemini::POLLUX_MIX_OUTPUT));
+}
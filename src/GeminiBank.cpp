@@ -0,0 +1,688 @@
+#include "Gemini.hpp"
+
+// Up to eight independent Castor and Pollux pairs, each with the settings a
+// Gemini of its own would have, rendered together with a pair in each lane
+// of Gemini's oscillators. The pairs share one set of knobs, which edit the
+// pair picked by PAIR_PARAM, and one set of polyphonic ports, with a channel
+// per pair.
+struct GeminiBank : Module {
+  using Mode = Gemini::Mode;
+  using ParamBank = Gemini::ParamBank;
+
+  // Gemini's params come first, and edit the selected pair. Filtering is
+  // shared by every pair, as it's a setting of the vectors they run in.
+  enum ParamId { PAIR_PARAM = Gemini::PARAMS_LEN, PARAMS_LEN };
+  static constexpr int INPUTS_LEN = Gemini::INPUTS_LEN;
+  static constexpr int OUTPUTS_LEN = Gemini::OUTPUTS_LEN;
+  enum LightId { LIGHTS_LEN };
+
+  static constexpr int MAX_PAIRS = 8;
+  static constexpr int MAX_GROUPS = MAX_PAIRS / 4;
+  static constexpr int PATCH_VERSION = 1;
+
+  // Each pair's settings, as Gemini::paramBank. Its mode and alt mode are in
+  // BUTTON_SLOT and ALT_MODE_BUTTON_SLOT.
+  alignas(64) std::array<ParamBank, MAX_PAIRS> paramBanks = [] {
+    std::array<ParamBank, MAX_PAIRS> banks;
+    banks.fill(Gemini::DEFAULT_PARAM_BANK);
+    return banks;
+  }();
+
+  // Gemini::knobCv for each pair's bank.
+  std::array<Gemini::KnobCv, MAX_PAIRS> knobCvs = [] {
+    std::array<Gemini::KnobCv, MAX_PAIRS> knobCvs;
+    knobCvs.fill(Gemini::knobCvFor(Gemini::DEFAULT_PARAM_BANK, Gemini::CHORUS,
+                                   false));
+    return knobCvs;
+  }();
+
+  // Pairs in lanes [4g, 4g + 4) of group g.
+  OscillatorState<simd::float_4> castor[MAX_GROUPS];
+  OscillatorState<simd::float_4> pollux[MAX_GROUPS];
+  Decimator<simd::float_4> castorDecimator[MAX_GROUPS];
+  Decimator<simd::float_4> polluxDecimator[MAX_GROUPS];
+  // Unlike Gemini's, the LFOs run at a different rate for each pair.
+  OscillatorState<simd::float_4> lfo[MAX_GROUPS] = {2.f, 2.f};
+  // Each pair's knobs whose steps would be heard, see Gemini::stepSlews().
+  Signals<ParamSlew> castorLevelSlew[MAX_PAIRS];
+  Signals<ParamSlew> polluxLevelSlew[MAX_PAIRS];
+  ParamSlew crossfadeSlew[MAX_PAIRS];
+  ParamSlew castorDutySlew[MAX_PAIRS];
+  ParamSlew polluxDutySlew[MAX_PAIRS];
+  float slewStep = 1.f;
+  // Whether each group's oscillators were heard in the last block.
+  bool castorHeard[MAX_GROUPS] = {};
+  bool polluxHeard[MAX_GROUPS] = {};
+  int blockPosition = 0;
+
+  struct alignas(64) Block {
+    // Inputs, per input, group of four pairs and frame. Lanes without a
+    // channel of their own read as 0V, unless the cable is mono, which every
+    // pair shares.
+    simd::float_4 cv[INPUTS_LEN][MAX_GROUPS][BLOCK_SIZE];
+    // The lanes with CV, as a mask.
+    simd::float_4 patched[INPUTS_LEN][MAX_GROUPS][BLOCK_SIZE];
+    // Outputs, per output, group and frame.
+    simd::float_4 out[OUTPUTS_LEN][MAX_GROUPS][BLOCK_SIZE];
+    // Pairs in the block's output.
+    int outChannels = 1;
+  };
+
+  Block block{};
+
+  // Set from the context menu: how many pairs run, and so the channels of
+  // each output. Written from the UI thread, see activePairs.
+  std::atomic<int> pairs{4};
+  // The pairs the current block renders, loaded from pairs once per block by
+  // processKernel().
+  int activePairs = 4;
+  // The pair the knobs currently show.
+  int selected = 0;
+  // Set when paramBanks is changed from outside the audio thread, so that
+  // the knobs are loaded from it again.
+  std::atomic<bool> knobsStale{true};
+  std::array<float, PARAMS_LEN> seenParams{};
+
+  // As Gemini's, set from the context menu and loaded once per block by
+  // updateParams().
+  std::atomic<bool> bandLimited{false};
+  std::atomic<int> oversampling{1};
+  int activeOversampling = 1;
+  bool activeBandLimited = false;
+  float sampleRate = 48000.f;
+
+  using Kernel = void (GeminiBank::*)();
+  Kernel kernel = getKernel(true, false);
+
+  // See Gemini::labelState, for the selected pair.
+  std::atomic<uint8_t> labelState{
+      Gemini::packLabelState(Gemini::CHORUS, false, true)};
+  uint8_t appliedLabelState = 0;
+  Gemini::LabelParams labelParams;
+
+  GeminiBank() {
+    config(PARAMS_LEN, INPUTS_LEN, OUTPUTS_LEN, LIGHTS_LEN);
+    Gemini::configControls(this, labelParams);
+    configSwitch(PAIR_PARAM, 0.f, MAX_PAIRS - 1, 0.f, "Pair",
+                 {"1", "2", "3", "4", "5", "6", "7", "8"});
+    this->refreshLabels();
+
+    rampMipmap();
+  }
+
+  json_t* dataToJson() override {
+    json_t* rootJ = json_object();
+    json_object_set_new(rootJ, "version", json_integer(PATCH_VERSION));
+    json_t* paramBanksJ = json_array();
+    for (const ParamBank& paramBank : paramBanks) {
+      json_t* paramBankJ = json_array();
+      for (float value : paramBank) {
+        json_array_append_new(paramBankJ, json_real(value));
+      }
+      json_array_append_new(paramBanksJ, paramBankJ);
+    }
+    json_object_set_new(rootJ, "paramBanks", paramBanksJ);
+    json_object_set_new(rootJ, "pairs",
+                        json_integer(pairs.load(std::memory_order_relaxed)));
+    json_object_set_new(
+        rootJ, "bandLimited",
+        json_boolean(bandLimited.load(std::memory_order_relaxed)));
+    json_object_set_new(
+        rootJ, "oversampling",
+        json_integer(oversampling.load(std::memory_order_relaxed)));
+    return rootJ;
+  }
+
+  void dataFromJson(json_t* rootJ) override {
+    if (json_t* pairsJ = json_object_get(rootJ, "pairs")) {
+      pairs.store(math::clamp(static_cast<int>(json_integer_value(pairsJ)),
+                              1, MAX_PAIRS),
+                  std::memory_order_relaxed);
+    }
+    if (json_t* bandLimitedJ = json_object_get(rootJ, "bandLimited")) {
+      bandLimited.store(json_boolean_value(bandLimitedJ),
+                        std::memory_order_relaxed);
+    }
+    if (json_t* oversamplingJ = json_object_get(rootJ, "oversampling")) {
+      int value = json_integer_value(oversamplingJ);
+      if (value == 1 || value == 2 || value == 4 || value == 8) {
+        oversampling.store(value, std::memory_order_relaxed);
+      }
+    }
+
+    // As Gemini's, each bank only ever gains slots.
+    json_t* paramBanksJ = json_object_get(rootJ, "paramBanks");
+    const size_t banks =
+        std::min<size_t>(json_array_size(paramBanksJ), MAX_PAIRS);
+    for (size_t pair = 0; pair < banks; pair++) {
+      json_t* paramBankJ = json_array_get(paramBanksJ, pair);
+      const size_t slots = std::min<size_t>(json_array_size(paramBankJ),
+                                            Gemini::SLOTS_LEN);
+      for (size_t slot = 0; slot < slots; slot++) {
+        ParamQuantity* quantity =
+            getParamQuantity(Gemini::SLOT_PARAMS[slot]);
+        paramBanks[pair][slot] = math::clamp(
+            static_cast<float>(
+                json_number_value(json_array_get(paramBankJ, slot))),
+            quantity->getMinValue(), quantity->getMaxValue());
+      }
+    }
+    knobsStale.store(true, std::memory_order_relaxed);
+  }
+
+  static Mode getMode(const ParamBank& bank) {
+    return static_cast<Mode>(
+        static_cast<int32_t>(bank[Gemini::BUTTON_SLOT]));
+  }
+
+  static bool getAltMode(const ParamBank& bank) {
+    return bank[Gemini::ALT_MODE_BUTTON_SLOT] == 1.f;
+  }
+
+  // Shows the pair's values for its mode on Gemini's knobs, other than
+  // filtering, which isn't the pair's own.
+  void loadKnobs(const ParamBank& bank, bool withMode) {
+    const auto& slots = Gemini::PARAM_SLOTS[getAltMode(bank)][getMode(bank)];
+    for (int p = 0; p < Gemini::PARAMS_LEN; p++) {
+      if (p == Gemini::FILTER_ENABLE_BUTTON_PARAM ||
+          (!withMode && (p == Gemini::BUTTON_PARAM ||
+                         p == Gemini::ALT_MODE_BUTTON_PARAM))) {
+        continue;
+      }
+      params[p].setValue(bank[slots[p]]);
+    }
+  }
+
+  // As Gemini::updateParams(), for the selected pair's bank. Picking another
+  // pair shows its values on the knobs.
+  void updateParams() {
+    const int nowSelected = math::clamp(
+        static_cast<int>(params[PAIR_PARAM].getValue()), 0, MAX_PAIRS - 1);
+    const bool nowAltMode =
+        params[Gemini::ALT_MODE_BUTTON_PARAM].getValue() == 1.f;
+    const Mode nowMode = static_cast<Mode>(
+        static_cast<int32_t>(params[Gemini::BUTTON_PARAM].getValue()));
+
+    ParamBank& bank = paramBanks[nowSelected];
+    const bool reload = knobsStale.exchange(false, std::memory_order_relaxed);
+    if (reload || nowSelected != selected) {
+      selected = nowSelected;
+      loadKnobs(bank, true);
+    } else if (nowAltMode != getAltMode(bank) || nowMode != getMode(bank)) {
+      bank[Gemini::ALT_MODE_BUTTON_SLOT] = nowAltMode;
+      bank[Gemini::BUTTON_SLOT] = nowMode;
+      loadKnobs(bank, false);
+    } else {
+      const auto& slots = Gemini::PARAM_SLOTS[nowAltMode][nowMode];
+      for (int p = 0; p < Gemini::PARAMS_LEN; p++) {
+        if (p != Gemini::FILTER_ENABLE_BUTTON_PARAM) {
+          bank[slots[p]] = params[p].getValue();
+        }
+      }
+    }
+    // Only the selected pair's knobs change, unless every bank was loaded.
+    for (int pair = reload ? 0 : selected;
+         pair < (reload ? MAX_PAIRS : selected + 1); pair++) {
+      const ParamBank& pairBank = paramBanks[pair];
+      knobCvs[pair] = Gemini::knobCvFor(pairBank, getMode(pairBank),
+                                        getAltMode(pairBank));
+    }
+
+    const bool filterEnabled =
+        params[Gemini::FILTER_ENABLE_BUTTON_PARAM].getValue() == 1.f;
+    for (int g = 0; g < MAX_GROUPS; g++) {
+      castor[g].enableFilter(filterEnabled);
+      pollux[g].enableFilter(filterEnabled);
+    }
+    const int nowOversampling =
+        this->oversampling.load(std::memory_order_relaxed);
+    if (nowOversampling != this->activeOversampling) {
+      this->activeOversampling = nowOversampling;
+      this->updateSampleRate();
+      // See Gemini::updateParams().
+      for (int g = 0; g < MAX_GROUPS; g++) {
+        castorDecimator[g].reset();
+        polluxDecimator[g].reset();
+      }
+    }
+    this->activeBandLimited =
+        this->bandLimited.load(std::memory_order_relaxed);
+    this->kernel = getKernel(filterEnabled, this->activeBandLimited);
+    this->labelState.store(
+        Gemini::packLabelState(getMode(bank), getAltMode(bank), filterEnabled),
+        std::memory_order_relaxed);
+    for (int p = 0; p < PARAMS_LEN; p++) {
+      seenParams[p] = params[p].getValue();
+    }
+  }
+
+  static Kernel getKernel(bool filterEnabled, bool bandLimited) {
+    static constexpr Kernel kernels[2][2] = {
+        {&GeminiBank::processKernel<false, false>,
+         &GeminiBank::processKernel<false, true>},
+        {&GeminiBank::processKernel<true, false>,
+         &GeminiBank::processKernel<true, true>},
+    };
+    return kernels[filterEnabled][bandLimited];
+  }
+
+  bool paramsChanged() {
+    if (knobsStale.load(std::memory_order_relaxed) ||
+        bandLimited.load(std::memory_order_relaxed) != activeBandLimited ||
+        oversampling.load(std::memory_order_relaxed) != activeOversampling) {
+      return true;
+    }
+    for (int p = 0; p < PARAMS_LEN; p++) {
+      if (params[p].getValue() != seenParams[p]) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void refreshLabels() {
+    const uint8_t state = labelState.load(std::memory_order_relaxed);
+    if (state != appliedLabelState) {
+      appliedLabelState = state;
+      Gemini::setLabels(labelParams, state);
+    }
+  }
+
+  // As Gemini::process(), with the same latency.
+  void process(const ProcessArgs& args) override {
+    captureFrame(blockPosition);
+    playFrame(blockPosition);
+    if (++blockPosition == BLOCK_SIZE) {
+      blockPosition = 0;
+      if (paramsChanged()) {
+        updateParams();
+      }
+      renderBlock();
+    }
+  }
+
+  void captureFrame(int position) {
+    for (int i = 0; i < INPUTS_LEN; i++) {
+      const int channels = inputs[i].getChannels();
+      for (int g = 0; g < MAX_GROUPS; g++) {
+        const simd::float_4 lane =
+            simd::float_4(0.f, 1.f, 2.f, 3.f) + static_cast<float>(4 * g);
+        const simd::float_4 patched =
+            channels == 1 ? simd::float_4::mask()
+                          : lane < static_cast<float>(channels);
+        block.patched[i][g][position] = patched;
+        block.cv[i][g][position] = simd::ifelse(
+            patched, inputs[i].getPolyVoltageSimd<simd::float_4>(4 * g), 0.f);
+      }
+    }
+  }
+
+  void playFrame(int position) {
+    const int channels = block.outChannels;
+    for (int o = 0; o < OUTPUTS_LEN; o++) {
+      for (int c = 0; c < channels; c += 4) {
+        outputs[o].setVoltageSimd(block.out[o][c / 4][position], c);
+      }
+      outputs[o].setChannels(channels);
+    }
+  }
+
+  void renderBlock() { (this->*kernel)(); }
+
+  template <bool FILTER, bool BAND_LIMITED>
+  void processKernel() {
+    // Loaded once, as the context menu sets it from the UI thread. Pairs it
+    // brings back are readied here, at the block they're first rendered in.
+    const int pairs = this->pairs.load(std::memory_order_relaxed);
+    for (int pair = activePairs; pair < pairs; pair++) {
+      activate(pair);
+    }
+    activePairs = pairs;
+    block.outChannels = activePairs;
+    for (int pair = 0; pair < activePairs; pair++) {
+      stepSlews(pair);
+    }
+    for (int g = 0; g * 4 < activePairs; g++) {
+      renderGroup<FILTER, BAND_LIMITED>(g);
+    }
+  }
+
+  // Readies a pair that wasn't rendered, whose slews stopped where it was
+  // left. Its levels fade in from silence, as it wasn't heard, and the knobs
+  // that only shape its sound start at the bank.
+  void activate(int pair) {
+    const ParamBank& bank = paramBanks[pair];
+    for (ParamSlew* level :
+         {&castorLevelSlew[pair].ramp, &castorLevelSlew[pair].pulse,
+          &castorLevelSlew[pair].sub, &polluxLevelSlew[pair].ramp,
+          &polluxLevelSlew[pair].pulse, &polluxLevelSlew[pair].sub}) {
+      level->reset(0.f);
+    }
+    crossfadeSlew[pair].reset(bank[Gemini::CROSSFADE_SLOT]);
+    const auto& slots = Gemini::PARAM_SLOTS[getAltMode(bank)][getMode(bank)];
+    castorDutySlew[pair].reset(bank[slots[Gemini::CASTOR_DUTY_PARAM]]);
+    polluxDutySlew[pair].reset(bank[slots[Gemini::POLLUX_DUTY_PARAM]]);
+  }
+
+  // See Gemini::slewStepOf().
+  float slewStepOf(Gemini::ParamId param) const {
+    return slewStep * Gemini::PARAM_RANGES[param].size();
+  }
+
+  // Moves the pair's smoothed knobs a block towards its bank.
+  void stepSlews(int pair) {
+    const ParamBank& bank = paramBanks[pair];
+    castorLevelSlew[pair].ramp.step(
+        bank[Gemini::CASTOR_RAMP_LEVEL_SLOT],
+        slewStepOf(Gemini::CASTOR_RAMP_LEVEL_PARAM));
+    castorLevelSlew[pair].pulse.step(
+        bank[Gemini::CASTOR_PULSE_LEVEL_SLOT],
+        slewStepOf(Gemini::CASTOR_PULSE_LEVEL_PARAM));
+    castorLevelSlew[pair].sub.step(bank[Gemini::CASTOR_SUB_LEVEL_SLOT],
+                                   slewStepOf(Gemini::CASTOR_SUB_LEVEL_PARAM));
+    polluxLevelSlew[pair].ramp.step(
+        bank[Gemini::POLLUX_RAMP_LEVEL_SLOT],
+        slewStepOf(Gemini::POLLUX_RAMP_LEVEL_PARAM));
+    polluxLevelSlew[pair].pulse.step(
+        bank[Gemini::POLLUX_PULSE_LEVEL_SLOT],
+        slewStepOf(Gemini::POLLUX_PULSE_LEVEL_PARAM));
+    polluxLevelSlew[pair].sub.step(bank[Gemini::POLLUX_SUB_LEVEL_SLOT],
+                                   slewStepOf(Gemini::POLLUX_SUB_LEVEL_PARAM));
+    crossfadeSlew[pair].step(bank[Gemini::CROSSFADE_SLOT],
+                             slewStepOf(Gemini::CROSSFADE_PARAM));
+    const auto& slots = Gemini::PARAM_SLOTS[getAltMode(bank)][getMode(bank)];
+    castorDutySlew[pair].step(bank[slots[Gemini::CASTOR_DUTY_PARAM]],
+                              slewStepOf(Gemini::CASTOR_DUTY_PARAM));
+    polluxDutySlew[pair].step(bank[slots[Gemini::POLLUX_DUTY_PARAM]],
+                              slewStepOf(Gemini::POLLUX_DUTY_PARAM));
+  }
+
+  // A smoothed knob of each pair in a group, see ParamSlew.
+  struct LaneSlew {
+    simd::float_4 from;
+    simd::float_4 to;
+
+    simd::float_4 at(float t) const { return from + (to - from) * t; }
+  };
+
+  // What Gemini works out per block from its knobs and mode, for each pair in
+  // a group.
+  struct GroupSettings {
+    simd::float_4 castorPitch;
+    simd::float_4 castorOffset;
+    simd::float_4 polluxOffset;
+    simd::float_4 syncRatio;
+    simd::float_4 lfoCv;
+    simd::float_4 lfoDepth;
+    // The lanes with a pair being rendered, as a mask. The others are
+    // silent and in no mode.
+    simd::float_4 active;
+    // The lanes in each mode, as masks.
+    simd::float_4 inMode[Gemini::MODES_LEN];
+    Signals<simd::float_4> castorFrom, castorTo, polluxFrom, polluxTo;
+    LaneSlew crossfade, castorDuty, polluxDuty;
+  };
+
+  GroupSettings getSettings(int g) {
+    GroupSettings settings;
+    simd::float_4 modes;
+    for (int lane = 0; lane < 4; lane++) {
+      const int pair = 4 * g + lane;
+      const Gemini::KnobCv& knobs = knobCvs[pair];
+      modes[lane] = getMode(paramBanks[pair]);
+      settings.castorPitch[lane] = knobs.castorPitch;
+      settings.castorOffset[lane] = knobs.castorOffset;
+      settings.polluxOffset[lane] = knobs.polluxOffset;
+      settings.syncRatio[lane] = knobs.syncRatio;
+      settings.lfoCv[lane] = knobs.lfoCv;
+      settings.lfoDepth[lane] = knobs.lfoDepth;
+
+      const Signals<ParamSlew>& castorLevel = castorLevelSlew[pair];
+      const Signals<ParamSlew>& polluxLevel = polluxLevelSlew[pair];
+      setLane(settings.castorFrom, levelsFrom(castorLevel), lane);
+      setLane(settings.castorTo, levelsTo(castorLevel), lane);
+      setLane(settings.polluxFrom, levelsFrom(polluxLevel), lane);
+      setLane(settings.polluxTo, levelsTo(polluxLevel), lane);
+      setLane(settings.crossfade, crossfadeSlew[pair], lane);
+      setLane(settings.castorDuty, castorDutySlew[pair], lane);
+      setLane(settings.polluxDuty, polluxDutySlew[pair], lane);
+    }
+    const simd::float_4 lanes =
+        simd::float_4(0.f, 1.f, 2.f, 3.f) + static_cast<float>(4 * g);
+    settings.active = lanes < static_cast<float>(activePairs);
+    for (Signals<simd::float_4>* levels :
+         {&settings.castorFrom, &settings.castorTo, &settings.polluxFrom,
+          &settings.polluxTo}) {
+      levels->ramp = simd::ifelse(settings.active, levels->ramp, 0.f);
+      levels->pulse = simd::ifelse(settings.active, levels->pulse, 0.f);
+      levels->sub = simd::ifelse(settings.active, levels->sub, 0.f);
+    }
+    for (int m = 0; m < Gemini::MODES_LEN; m++) {
+      settings.inMode[m] =
+          (modes == static_cast<float>(m)) & settings.active;
+    }
+    return settings;
+  }
+
+  static void setLane(Signals<simd::float_4>& lanes,
+                      const Signals<float>& value, int lane) {
+    lanes.ramp[lane] = value.ramp;
+    lanes.pulse[lane] = value.pulse;
+    lanes.sub[lane] = value.sub;
+  }
+
+  static void setLane(LaneSlew& lanes, const ParamSlew& slew, int lane) {
+    lanes.from[lane] = slew.from;
+    lanes.to[lane] = slew.to;
+  }
+
+  // Renders the pairs of group g. Each pair's mode is a lane mask, so where
+  // Gemini picks a kernel for its mode, this adds each mode's LFO and sync to
+  // the lanes in it.
+  template <bool FILTER, bool BAND_LIMITED>
+  void renderGroup(int g) {
+    using V = simd::float_4;
+    const GroupSettings settings = getSettings(g);
+    const V chorus = settings.inMode[Gemini::CHORUS];
+    const V pwm = settings.inMode[Gemini::LFO_PWM];
+    const V fm = settings.inMode[Gemini::LFO_FM];
+    const V sync = settings.inMode[Gemini::HARD_SYNC];
+
+    // As Gemini::processKernel(), but heard in any lane.
+    const bool mixConnected = outputs[Gemini::MIX_OUTPUT].isConnected();
+    const LaneSlew& crossfade = settings.crossfade;
+    const V active = settings.active;
+    const bool castorHeard =
+        anyHeard(isHeard(settings.castorFrom, settings.castorTo)) &&
+        (outputs[Gemini::CASTOR_MIX_OUTPUT].isConnected() ||
+         (mixConnected &&
+          simd::movemask(((crossfade.from != 1.f) | (crossfade.to != 1.f)) &
+                         active) != 0));
+    const bool polluxHeard =
+        anyHeard(isHeard(settings.polluxFrom, settings.polluxTo)) &&
+        (outputs[Gemini::POLLUX_MIX_OUTPUT].isConnected() ||
+         (mixConnected &&
+          simd::movemask(((crossfade.from != 0.f) | (crossfade.to != 0.f)) &
+                         active) != 0));
+    if (castorHeard && !this->castorHeard[g]) {
+      castor[g].resetFilters();
+      castorDecimator[g].reset();
+    }
+    if (polluxHeard && !this->polluxHeard[g]) {
+      pollux[g].resetFilters();
+      polluxDecimator[g].reset();
+    }
+    this->castorHeard[g] = castorHeard;
+    this->polluxHeard[g] = polluxHeard;
+    // Castor has to run for Pollux to follow it in hard sync.
+    const bool syncing = polluxHeard && simd::movemask(sync) != 0;
+
+    V castorPitch[BLOCK_SIZE];
+    V polluxPitch[BLOCK_SIZE];
+    V castorDuty[BLOCK_SIZE];
+    V polluxDuty[BLOCK_SIZE];
+    // See Gemini::getPitchCv() and getDutyCycle().
+    lfo[g].updatePitch(settings.lfoCv);
+    for (int f = 0; f < BLOCK_SIZE; f++) {
+      lfo[g].updatePhase();
+      const V lfoValue = lfo[g].triangle() * settings.lfoDepth;
+      const V castorIn = block.cv[Gemini::CASTOR_PITCH_INPUT][g][f];
+      const V polluxIn = block.cv[Gemini::POLLUX_PITCH_INPUT][g][f];
+      const V castorPatched = block.patched[Gemini::CASTOR_PITCH_INPUT][g][f];
+      const V polluxPatched = block.patched[Gemini::POLLUX_PITCH_INPUT][g][f];
+
+      const V castorCv =
+          simd::ifelse(castorPatched, castorIn + settings.castorOffset,
+                       settings.castorPitch) +
+          simd::ifelse(fm, lfoValue, 0.f);
+      castorPitch[f] = castorCv;
+      const V polluxCv = simd::ifelse(polluxPatched, polluxIn, castorCv) +
+                         settings.polluxOffset +
+                         simd::ifelse(chorus, lfoValue, 0.f);
+      const V syncedCv =
+          simd::ifelse(polluxPatched, simd::clamp(polluxIn, -6.f, 6.f),
+                       castorCv) +
+          settings.syncRatio;
+      polluxPitch[f] = simd::ifelse(sync, syncedCv, polluxCv);
+
+      const float t = static_cast<float>(f + 1) / BLOCK_SIZE;
+      const V pwmLfo = simd::ifelse(pwm, lfoValue, 0.f);
+      const V castorDutyCv = block.cv[Gemini::CASTOR_DUTY_INPUT][g][f];
+      const V polluxDutyCv = block.cv[Gemini::POLLUX_DUTY_INPUT][g][f];
+      castorDuty[f] = simd::clamp(
+          settings.castorDuty.at(t) + castorDutyCv / 5.f + pwmLfo, -1.f, 1.f);
+      polluxDuty[f] = simd::clamp(
+          settings.polluxDuty.at(t) + polluxDutyCv / 5.f + pwmLfo, -1.f, 1.f);
+    }
+
+    const int oversampling = this->activeOversampling;
+    if (!syncing && !castorHeard) {
+      castor[g].skip(castorPitch, BLOCK_SIZE, oversampling);
+    }
+    if (!polluxHeard) {
+      pollux[g].skip(polluxPitch, BLOCK_SIZE, oversampling);
+    }
+    // In slices, as Gemini::runLanes().
+    const int frames = OscillatorBlock<V>::MAX_SAMPLES / oversampling;
+    OscillatorBlock<V> castorBlock;
+    OscillatorBlock<V> polluxBlock;
+    for (int start = 0; start < BLOCK_SIZE; start += frames) {
+      const float t0 = static_cast<float>(start) / BLOCK_SIZE;
+      const float t1 = static_cast<float>(start + frames) / BLOCK_SIZE;
+      if (syncing) {
+        castor[g].advance<HardSync::LEADER>(castorBlock, castorPitch + start,
+                                            frames, oversampling);
+        // Only pairs in hard sync restart Pollux.
+        for (int s = 0; s < frames * oversampling; s++) {
+          castorBlock.reset[s] &= sync;
+        }
+      } else if (castorHeard) {
+        castor[g].advance<HardSync::NONE>(castorBlock, castorPitch + start,
+                                          frames, oversampling);
+      }
+      if (castorHeard) {
+        castor[g].render<FILTER, BAND_LIMITED>(
+            castorBlock, castorDuty + start, frames, oversampling,
+            levelsAt(settings.castorFrom, settings.castorTo, t0),
+            levelsAt(settings.castorFrom, settings.castorTo, t1));
+      }
+      if (syncing) {
+        pollux[g].advance<HardSync::FOLLOWER>(polluxBlock, polluxPitch + start,
+                                              frames, oversampling,
+                                              &castorBlock);
+      } else if (polluxHeard) {
+        pollux[g].advance<HardSync::NONE>(polluxBlock, polluxPitch + start,
+                                          frames, oversampling);
+      }
+      if (polluxHeard) {
+        pollux[g].render<FILTER, BAND_LIMITED>(
+            polluxBlock, polluxDuty + start, frames, oversampling,
+            levelsAt(settings.polluxFrom, settings.polluxTo, t0),
+            levelsAt(settings.polluxFrom, settings.polluxTo, t1));
+      }
+
+      for (int i = 0; i < frames; i++) {
+        const int f = start + i;
+        const V castorOut =
+            castorHeard ? castorDecimator[g].process(
+                              &castorBlock.out[i * oversampling], oversampling)
+                        : 0.f;
+        const V polluxOut =
+            polluxHeard ? polluxDecimator[g].process(
+                              &polluxBlock.out[i * oversampling], oversampling)
+                        : 0.f;
+        const float t = static_cast<float>(f + 1) / BLOCK_SIZE;
+        block.out[Gemini::CASTOR_MIX_OUTPUT][g][f] = castorOut;
+        block.out[Gemini::POLLUX_MIX_OUTPUT][g][f] = polluxOut;
+        block.out[Gemini::MIX_OUTPUT][g][f] =
+            simd::crossfade(castorOut, polluxOut, settings.crossfade.at(t));
+      }
+    }
+  }
+
+  void onSampleRateChange(const SampleRateChangeEvent& e) override {
+    this->sampleRate = e.sampleRate;
+    this->updateSampleRate();
+  }
+
+  void updateSampleRate() {
+    slewStep = BLOCK_SIZE / (Gemini::SLEW_TIME * sampleRate);
+    for (int g = 0; g < MAX_GROUPS; g++) {
+      lfo[g].updateSampleRate(sampleRate);
+      castor[g].updateSampleRate(sampleRate * activeOversampling);
+      pollux[g].updateSampleRate(sampleRate * activeOversampling);
+    }
+  }
+};
+
+struct GeminiBankWidget : ModuleWidget {
+  GeminiBankWidget(GeminiBank* module) {
+    setModule(module);
+    setPanel(
+        createPanel(asset::plugin(pluginInstance, "res/GeminiBank.svg")));
+
+    addGeminiControls(this, module);
+    addParam(createParamCentered<RoundBlackSnapKnob>(
+        mm2px(Vec(75.64, 64.25)), module, GeminiBank::PAIR_PARAM));
+  }
+
+  void appendContextMenu(Menu* menu) override {
+    GeminiBank* module = getModule<GeminiBank>();
+
+    menu->addChild(new MenuSeparator);
+    menu->addChild(createIndexSubmenuItem(
+        "Pairs", {"1", "2", "3", "4", "5", "6", "7", "8"},
+        [=]() {
+          return static_cast<size_t>(
+              module->pairs.load(std::memory_order_relaxed) - 1);
+        },
+        [=](size_t index) {
+          module->pairs.store(index + 1, std::memory_order_relaxed);
+        }));
+    menu->addChild(createBoolMenuItem(
+        "Band-limited waveforms", "",
+        [=]() { return module->bandLimited.load(std::memory_order_relaxed); },
+        [=](bool enabled) {
+          module->bandLimited.store(enabled, std::memory_order_relaxed);
+        }));
+    menu->addChild(createIndexSubmenuItem(
+        "Oversampling", {"1x", "2x", "4x", "8x"},
+        [=]() {
+          return static_cast<size_t>(
+              std::log2(module->oversampling.load(std::memory_order_relaxed)));
+        },
+        [=](size_t index) {
+          module->oversampling.store(1 << index, std::memory_order_relaxed);
+        }));
+  }
+
+  void step() override {
+    if (GeminiBank* module = getModule<GeminiBank>()) {
+      module->refreshLabels();
+    }
+    ModuleWidget::step();
+  }
+};
+
+Model* modelGeminiBank =
+    createModel<GeminiBank, GeminiBankWidget>("GeminiBank");
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <rack.hpp>
+
+#include "wide.hpp"
+
+// std::exp2 isn't constexpr, so tables are built with this instead. Accurate
+// to within double precision.
+constexpr double constexprExp2(double x) {
+  int whole = static_cast<int>(x);
+  if (whole > x) {
+    whole--;
+  }
+  const double y = (x - whole) * 0.69314718055994530942;  // in [0, ln(2))
+  double term = 1.0;
+  double sum = 1.0;
+  for (int n = 1; n < 25; n++) {
+    term *= y / n;
+    sum += term;
+  }
+  for (; whole > 0; whole--) {
+    sum *= 2.0;
+  }
+  for (; whole < 0; whole++) {
+    sum /= 2.0;
+  }
+  return sum;
+}
+
+// 2^whole for an integer valued whole in [-126, 127], built directly from the
+// exponent bits.
+inline float exp2Whole(float whole) {
+  const int32_t bits = (static_cast<int32_t>(whole) + 127) << 23;
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+template <wide::FloatVector V>
+V exp2Whole(V whole) {
+  return V::cast((wide::IntOf<V>(whole) + 127) << 23);
+}
+
+// 2^x, within a relative error of 2.6e-6 (0.0045 cents) of std::pow(2, x).
+// The fractional part comes from a degree 4 minimax polynomial, the integer
+// part from the exponent bits, so it vectorises over simd vector lanes.
+// Inputs are clamped to [-126, 126].
+template <typename T>
+T fastExp2(T x) {
+  // ifelse rather than fmin/fmax, which don't inline for scalars.
+  x = wide::ifelse(x < -126.f, -126.f, x);
+  x = wide::ifelse(x > 126.f, 126.f, x);
+  const T whole = wide::floor(x);
+  const T f = x - whole;  // in [0, 1)
+  const T fraction =
+      1.00000259f +
+      f * (0.693003834f +
+           f * (0.241442757f + f * (0.0520114606f + f * 0.0135341679f)));
+  return fraction * exp2Whole(whole);
+}
@@ -7,6 +7,7 @@ void init(Plugin* p) {
 
   // Add modules here
   p->addModel(modelGemini);
+  p->addModel(modelGeminiBank);
 
   // Any other plugin initialization may go here.
   // As an alternative, consider lazy-loading assets and lookup tables when your
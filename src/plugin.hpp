@@ -8,3 +8,4 @@ extern Plugin* pluginInstance;
 
 // Declare each Model, defined in each module source file
 extern Model* modelGemini;
+extern Model* modelGeminiBank;
@@ -0,0 +1,302 @@
+#pragma once
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <rack.hpp>
+#include <type_traits>
+
+// 8 and 16 lane counterparts of simd::float_4 and simd::int32_4, with the
+// parts of Rack's simd API that Gemini's templates use, for the kernels it
+// runs on CPUs with AVX2 or AVX-512. They're built on GCC and Clang vector
+// extensions rather than intrinsics, so they compile for any target: the
+// wide kernels are compiled for their instruction set by a target attribute,
+// and code outside them falls back to narrower instructions.
+//
+// Not on Windows, where GCC can't align the kernels' 32 and 64 byte stack
+// variables beyond the 16 bytes the Win64 ABI guarantees (GCC PR 54412), so
+// AVX loads from them would fault.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && \
+    !defined(_WIN32)
+#define GEMINI_WIDE_KERNELS 1
+#endif
+
+// GCC notes that passing these 32 and 64 byte vectors by value changed ABI
+// in GCC 4.6. They never leave the plugin.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+// Templates written against both widths call the simd functions through
+// this namespace, which has Rack's simd::float_4 overloads as well as its
+// own.
+namespace wide {
+
+using rack::simd::float_4;
+using rack::simd::int32_4;
+
+using rack::simd::clamp;
+using rack::simd::crossfade;
+using rack::simd::fabs;
+using rack::simd::floor;
+using rack::simd::fmax;
+using rack::simd::fmin;
+using rack::simd::ifelse;
+using rack::simd::movemask;
+
+// GCC drops vector_size from a type whose size depends on a template
+// parameter, so each width is spelled out.
+template <typename T, int N>
+struct NativeVector;
+
+template <typename T, int N>
+struct Vector;
+
+#define DECLARE_NATIVE_VECTOR(T, N)                        \
+  template <>                                              \
+  struct NativeVector<T, N> {                              \
+    typedef T type __attribute__((vector_size(N * sizeof(T)))); \
+  };
+DECLARE_NATIVE_VECTOR(float, 8)
+DECLARE_NATIVE_VECTOR(float, 16)
+DECLARE_NATIVE_VECTOR(int32_t, 8)
+DECLARE_NATIVE_VECTOR(int32_t, 16)
+#undef DECLARE_NATIVE_VECTOR
+
+template <int N>
+  requires(N == 8 || N == 16)
+struct Vector<int32_t, N>;
+
+template <int N>
+  requires(N == 8 || N == 16)
+struct Vector<float, N> {
+  using type = float;
+  using Native = typename NativeVector<float, N>::type;
+  using Bits = typename NativeVector<int32_t, N>::type;
+  constexpr static int size = N;
+
+  Native v;
+
+  Vector() = default;
+  Vector(Native v) : v(v) {}
+  // Broadcast through the integer lanes: GCC can split a float broadcast into
+  // SSE pieces when it compiles this outside a wide kernel, before inlining
+  // it into one, but leaves an integer one whole.
+  Vector(float x) : v(Native(Bits{} + std::bit_cast<int32_t>(x))) {}
+  explicit Vector(Vector<int32_t, N> a);
+  // Copies are spelled out, as vector assignments: GCC lays out a struct
+  // holding a vector it has no registers for as a plain block of memory,
+  // which it then copies in 16 byte pieces even inside a wide kernel.
+  Vector(const Vector& a) : v(a.v) {}
+  Vector& operator=(const Vector& a) {
+    v = a.v;
+    return *this;
+  }
+
+  float& operator[](int i) { return reinterpret_cast<float*>(&v)[i]; }
+  const float& operator[](int i) const {
+    return reinterpret_cast<const float*>(&v)[i];
+  }
+
+  static Vector load(const float* x) {
+    Vector a;
+    std::memcpy(&a.v, x, sizeof(a.v));
+    return a;
+  }
+  void store(float* x) const { std::memcpy(x, &v, sizeof(v)); }
+  static Vector cast(Vector<int32_t, N> a);
+
+  friend Vector operator+(Vector a, Vector b) { return a.v + b.v; }
+  friend Vector operator-(Vector a, Vector b) { return a.v - b.v; }
+  friend Vector operator*(Vector a, Vector b) { return a.v * b.v; }
+  friend Vector operator/(Vector a, Vector b) { return a.v / b.v; }
+  friend Vector operator-(Vector a) { return -a.v; }
+  friend Vector& operator+=(Vector& a, Vector b) { return a = a + b; }
+  friend Vector& operator-=(Vector& a, Vector b) { return a = a - b; }
+  friend Vector& operator*=(Vector& a, Vector b) { return a = a * b; }
+  friend Vector& operator/=(Vector& a, Vector b) { return a = a / b; }
+
+  // Comparisons give a mask with all bits of each lane set or clear, as for
+  // simd::float_4.
+  friend Vector operator==(Vector a, Vector b) { return mask(a.v == b.v); }
+  friend Vector operator!=(Vector a, Vector b) { return mask(a.v != b.v); }
+  friend Vector operator<(Vector a, Vector b) { return mask(a.v < b.v); }
+  friend Vector operator>(Vector a, Vector b) { return mask(a.v > b.v); }
+  friend Vector operator<=(Vector a, Vector b) { return mask(a.v <= b.v); }
+  friend Vector operator>=(Vector a, Vector b) { return mask(a.v >= b.v); }
+  // For masks only, as the signed maximum and minimum of their 0 and -1
+  // lanes: GCC folds a plain `&` of two comparisons into one on its boolean
+  // vectors, which it then takes apart lane by lane for AVX-512.
+  friend Vector operator&(Vector a, Vector b) {
+    const Bits x = Bits(a.v), y = Bits(b.v);
+    return mask(x > y ? x : y);
+  }
+  friend Vector operator|(Vector a, Vector b) {
+    const Bits x = Bits(a.v), y = Bits(b.v);
+    return mask(x < y ? x : y);
+  }
+
+ private:
+  static Vector mask(Bits bits) { return Native(bits); }
+};
+
+template <int N>
+  requires(N == 8 || N == 16)
+struct Vector<int32_t, N> {
+  using type = int32_t;
+  using Native = typename NativeVector<int32_t, N>::type;
+  constexpr static int size = N;
+
+  Native v;
+
+  Vector() = default;
+  Vector(Native v) : v(v) {}
+  Vector(int32_t x) : v(Native{} + x) {}
+  // Truncates towards zero, like simd::int32_4.
+  explicit Vector(Vector<float, N> a)
+      : v(__builtin_convertvector(a.v, Native)) {}
+  Vector(const Vector& a) : v(a.v) {}
+  Vector& operator=(const Vector& a) {
+    v = a.v;
+    return *this;
+  }
+
+  int32_t& operator[](int i) { return reinterpret_cast<int32_t*>(&v)[i]; }
+  const int32_t& operator[](int i) const {
+    return reinterpret_cast<const int32_t*>(&v)[i];
+  }
+
+  static Vector cast(Vector<float, N> a) { return Native(a.v); }
+
+  friend Vector operator+(Vector a, Vector b) { return a.v + b.v; }
+  friend Vector operator-(Vector a, Vector b) { return a.v - b.v; }
+  friend Vector operator&(Vector a, Vector b) { return a.v & b.v; }
+  friend Vector operator|(Vector a, Vector b) { return a.v | b.v; }
+  friend Vector operator<<(Vector a, int b) { return a.v << b; }
+  friend Vector operator>>(Vector a, int b) { return a.v >> b; }
+  friend Vector operator==(Vector a, Vector b) { return a.v == b.v; }
+  friend Vector operator<(Vector a, Vector b) { return a.v < b.v; }
+  friend Vector operator>(Vector a, Vector b) { return a.v > b.v; }
+};
+
+template <int N>
+  requires(N == 8 || N == 16)
+Vector<float, N>::Vector(Vector<int32_t, N> a)
+    : v(__builtin_convertvector(a.v, Native)) {}
+
+template <int N>
+  requires(N == 8 || N == 16)
+Vector<float, N> Vector<float, N>::cast(Vector<int32_t, N> a) {
+  return Native(a.v);
+}
+
+using float_8 = Vector<float, 8>;
+using int32_8 = Vector<int32_t, 8>;
+using float_16 = Vector<float, 16>;
+using int32_16 = Vector<int32_t, 16>;
+
+// The float and int vectors of each width, for templates over either.
+template <typename V>
+struct VectorTraits;
+
+template <typename F, typename I>
+struct VectorPair {
+  using Float = F;
+  using Int = I;
+};
+
+template <>
+struct VectorTraits<float_4> : VectorPair<float_4, int32_4> {};
+template <>
+struct VectorTraits<int32_4> : VectorPair<float_4, int32_4> {};
+template <>
+struct VectorTraits<float_8> : VectorPair<float_8, int32_8> {};
+template <>
+struct VectorTraits<int32_8> : VectorPair<float_8, int32_8> {};
+template <>
+struct VectorTraits<float_16> : VectorPair<float_16, int32_16> {};
+template <>
+struct VectorTraits<int32_16> : VectorPair<float_16, int32_16> {};
+
+template <typename V>
+using FloatOf = typename VectorTraits<V>::Float;
+template <typename V>
+using IntOf = typename VectorTraits<V>::Int;
+
+template <typename V>
+concept FloatVector = std::is_same_v<V, FloatOf<V>>;
+template <typename V>
+concept IntVector = std::is_same_v<V, IntOf<V>>;
+
+// Only the first argument is deduced, so the others can be floats, as with
+// the simd::float_4 overloads.
+template <int N>
+using SameWidth = std::type_identity_t<Vector<float, N>>;
+
+template <int N>
+  requires(N == 8 || N == 16)
+Vector<float, N> ifelse(Vector<float, N> mask, SameWidth<N> a,
+                        SameWidth<N> b) {
+  using Bits = typename Vector<float, N>::Bits;
+  const Bits bits = Bits(mask.v);
+  return typename Vector<float, N>::Native((Bits(a.v) & bits) |
+                                           (Bits(b.v) & ~bits));
+}
+
+// Like _mm_max_ps and _mm_min_ps, these return b when either is NaN.
+template <int N>
+  requires(N == 8 || N == 16)
+Vector<float, N> fmax(Vector<float, N> a, SameWidth<N> b) {
+  return a.v > b.v ? a.v : b.v;
+}
+
+template <int N>
+  requires(N == 8 || N == 16)
+Vector<float, N> fmin(Vector<float, N> a, SameWidth<N> b) {
+  return a.v < b.v ? a.v : b.v;
+}
+
+template <int N>
+  requires(N == 8 || N == 16)
+Vector<float, N> clamp(Vector<float, N> x, SameWidth<N> a = 0.f,
+                       SameWidth<N> b = 1.f) {
+  return fmin(fmax(x, a), b);
+}
+
+template <int N>
+  requires(N == 8 || N == 16)
+Vector<float, N> fabs(Vector<float, N> a) {
+  using Bits = typename Vector<float, N>::Bits;
+  return typename Vector<float, N>::Native(Bits(a.v) & INT32_MAX);
+}
+
+// Exact for |a| < 2^31, which covers the phases and exponents it's used for.
+template <int N>
+  requires(N == 8 || N == 16)
+Vector<float, N> floor(Vector<float, N> a) {
+  const Vector<float, N> truncated{Vector<int32_t, N>(a)};
+  return truncated - ifelse(truncated > a, 1.f, 0.f);
+}
+
+template <int N>
+  requires(N == 8 || N == 16)
+Vector<float, N> crossfade(Vector<float, N> a, SameWidth<N> b,
+                           SameWidth<N> p) {
+  return a + (b - a) * p;
+}
+
+// One SSE movemask per group of four lanes.
+template <int N>
+  requires(N == 8 || N == 16)
+int movemask(Vector<float, N> a) {
+  int bits = 0;
+  for (int p = 0; p < N / 4; p++) {
+    float_4 part;
+    std::memcpy(&part, &a[4 * p], sizeof(part));
+    bits |= movemask(part) << (4 * p);
+  }
+  return bits;
+}
+
+}  // namespace wide
+
+#pragma GCC diagnostic pop